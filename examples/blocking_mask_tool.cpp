@@ -5,8 +5,10 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "iqalab/image_cache.hpp"
 #include "iqalab/image_type.hpp"          // stem_lower, is_supported_image
 #include "iqalab/iqalab.hpp"
+#include "iqalab/pair_pipeline.hpp"
 #include "iqalab/utils/file_grouping.hpp" // collect_reference_files, collect_distorted_files, group_distorted_by_reference
 #include "iqalab/utils/mask_utils.hpp"
 #include "iqalab/utils/path_utils.hpp"    // path_to_utf8, ...
@@ -163,6 +165,9 @@ static void process_directory_mode(const Options& opts)
 
     fs::create_directories(outDir);
 
+    // Decoded references; hit/miss counts are reported at the end.
+    ImageCache imageCache;
+
     auto refFiles  = collect_reference_files(refDir);
     auto distFiles = collect_distorted_files(distDir);
     auto groups    = group_distorted_by_reference(refFiles, distFiles);
@@ -175,63 +180,84 @@ static void process_directory_mode(const Options& opts)
 
     std::cout << "Found " << totalRefs << " reference images\n";
 
-    for (std::size_t i = 0; i < totalRefs; ++i) {
-        const fs::path& refPath = refFiles[i];
-        const std::string refKey = stem_lower(refPath); // klucz jak w impulse_mask_tool
-
-        auto it = groups.find(refKey);
-        if (it == groups.end() || it->second.empty()) {
+    for (const fs::path& refPath : refFiles) {
+        const auto it = groups.find(stem_lower(refPath));
+        if (it == groups.end() || it->second.empty())
             std::cout << "[ref] " << refPath << " -> no distorted images\n";
-            continue;
-        }
+    }
 
-        std::cout << "[ref] " << refPath << " -> " << it->second.size() << " distorted\n";
+    std::vector<ImagePair> pairs = pairs_from_groups(refFiles, groups);
+    std::erase_if(pairs, [](const ImagePair& p) {
+        if (is_image_file(p.distPath))
+            return false;
+        std::cout << "Skipping unsupported image: " << p.distPath << "\n";
+        return true;
+    });
+
+    // Decode ahead on worker threads; output images go through the writer.
+    PairPrefetchOptions prefetchOptions;
+    prefetchOptions.refCache = &imageCache;
+    PairPrefetcher prefetcher(std::move(pairs), prefetchOptions);
+    AsyncImageWriter writer;
+
+    LoadedPair pair;
+    fs::path prevRef;
+    while (prefetcher.next(pair)) {
+        const fs::path& refPath  = pair.paths.refPath;
+        const fs::path& distPath = pair.paths.distPath;
+        const cv::Mat& refImg  = pair.ref;
+        const cv::Mat& distImg = pair.dist;
+
+        const bool firstOfRef = refPath != prevRef;
+        if (firstOfRef) {
+            prevRef = refPath;
+            std::cout << "[ref] " << refPath << " -> "
+                      << groups.at(stem_lower(refPath)).size() << " distorted\n";
+        }
 
-        cv::Mat refImg = safe_imread_color(refPath);
+        if (pair.sizeMismatch) {
+            std::cerr << "Size mismatch: " << refPath
+                      << " vs " << distPath << "\n";
+            continue;
+        }
         if (refImg.empty()) {
-            std::cerr << "Skipping ref (cannot read): " << refPath << "\n";
+            if (firstOfRef)
+                std::cerr << "Skipping ref (cannot read): " << refPath << "\n";
+            continue;
+        }
+        if (distImg.empty()) {
+            std::cerr << "Skipping dist (cannot read): " << distPath << "\n";
             continue;
         }
 
-        const auto& distList = it->second;
-        for (const fs::path& distPath : distList) {
-            if (!is_image_file(distPath)) {
-                std::cout << "Skipping unsupported image: " << distPath << "\n";
-                continue;
-            }
-
-            cv::Mat distImg = safe_imread_color(distPath);
-            if (distImg.empty()) {
-                std::cerr << "Skipping dist (cannot read): " << distPath << "\n";
-                continue;
-            }
+        cv::Mat mask = flat_blocking_to_mask(refImg, distImg);
+        if (mask.empty()) {
+            std::cerr << "blocking_to_mask returned empty mask for: " << distPath << "\n";
+            continue;
+        }
 
-            cv::Mat mask = flat_blocking_to_mask(refImg, distImg);
-            if (mask.empty()) {
-                std::cerr << "blocking_to_mask returned empty mask for: " << distPath << "\n";
-                continue;
-            }
+        if (count_nonzero_threshold(mask) == 0) {
+            std::cout << "no blocks, skip, for: " << distPath << "\n";
+            continue;
+        }
 
-            if (count_nonzero_threshold(mask) == 0) {
-                std::cout << "no blocks, skip, for: " << distPath << "\n";
-                continue;
-            }
+        cv::Mat out = apply_block_mask(distImg, mask);
+        if (out.empty()) {
+            std::cerr << "apply_block_mask failed for: " << distPath << "\n";
+            continue;
+        }
 
-            cv::Mat out = apply_block_mask(distImg, mask);
-            if (out.empty()) {
-                std::cerr << "apply_block_mask failed for: " << distPath << "\n";
-                continue;
-            }
+        fs::path outPath = outDir / (distPath.stem().string() + "_blocks" + distPath.extension().string());
 
-            fs::path outPath = outDir / (distPath.stem().string() + "_blocks" + distPath.extension().string());
+        writer.write(outPath, out);
+        std::cout << "Queued: " << outPath << "\n";
+    }
 
-            if (!cv::imwrite(outPath, out)) {
-                std::cerr << "ERROR: cannot write image: " << outPath << "\n";
-            } else {
-                std::cout << "Wrote: " << outPath << "\n";
-            }
-        }
+    for (const fs::path& failed : writer.finish()) {
+        std::cerr << "ERROR: cannot write image: " << failed << "\n";
     }
+
+    write_image_cache_stats(std::cerr, imageCache.stats());
 }
 
 //----------------------------------------------------------------------
@@ -1,78 +1,60 @@
-#include "iqalab/halo.hpp"
+#include "iqalab/execution_policy.hpp"
+#include "iqalab/image_cache.hpp"
+#include "iqalab/lab_disk_cache.hpp"
+#include "iqalab/pair_metrics.hpp"
+#include "iqalab/pair_pipeline.hpp"
+#include "iqalab/region_cache.hpp"
 #include "iqalab/region_provider.hpp"
+#include "iqalab/screening.hpp"
+#include "iqalab/utils/content_hash.hpp"
+#include "iqalab/utils/dataset_scan.hpp"
 #include "iqalab/utils/path_utils.hpp"
+#include "iqalab/utils/thread_pool.hpp"
 
-#include <iqalab/blur.hpp>
-#include <iqalab/mse.hpp>
-#include <iqalab/region_masks.hpp>
 #include <iqalab/utils/file_grouping.hpp>
 
 #include <opencv2/opencv.hpp>
 
+#include <chrono>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <system_error>
 #include <vector>
 
 namespace fs = std::filesystem;
 
-// Simple pair of reference and distorted file paths (as strings for CSV output).
-struct Pair
-{
-    std::string refPath;
-    std::string distPath;
-};
-
-// Masks used for blur/sharpening measurement (dilated regions).
-struct BlurRegionMasks
-{
-    cv::Mat flat;
-    cv::Mat mid;
-    cv::Mat detail;
-};
-
-// Load image from disk and convert to Lab (CV_32FC3).
-bool load_image_lab32(const std::string& path, cv::Mat& lab)
-{
-    cv::Mat bgr = cv::imread(path, cv::IMREAD_COLOR);
-    if (bgr.empty())
-    {
-        std::cerr << "Cannot read image: " << path << "\n";
-        return false;
-    }
-
-    cv::Mat lab8;
-    cv::cvtColor(bgr, lab8, cv::COLOR_BGR2Lab);
-    lab8.convertTo(lab, CV_32FC3);
-    return true;
-}
+using iqa::utils::ImagePair;
 
-// Load pairs from a text file where each line contains:
-//   <ref_path> <dist_path>
-std::vector<Pair> load_pairs_from_file(const std::string& listPath)
+// Image files under `root`: the non-recursive listing by default, or a
+// recursive scan cached as a manifest in `manifestDir` when it is set.
+std::vector<fs::path> collect_dataset_files(const std::string& root,
+                                            const std::string& manifestDir,
+                                            bool reference)
 {
-    std::vector<Pair> pairs;
-    std::ifstream in(listPath);
-    if (!in)
+    if (manifestDir.empty())
     {
-        std::cerr << "Cannot open pairs file: " << listPath << "\n";
-        return pairs;
+        return reference ? iqa::utils::collect_reference_files(root)
+                         : iqa::utils::collect_distorted_files(root);
     }
 
-    std::string ref, dist;
-    while (in >> ref >> dist)
-    {
-        pairs.push_back(Pair{ref, dist});
-    }
-    return pairs;
+    // A manifest directory that cannot be created only disables persisting.
+    std::error_code ec;
+    fs::create_directories(manifestDir, ec);
+    const fs::path absRoot = fs::absolute(root).lexically_normal();
+    const fs::path manifestFile = fs::path(manifestDir) /
+        (iqa::utils::hash_to_hex(iqa::utils::hash_string(absRoot.generic_string())) + ".iqdm");
+    return iqa::utils::load_or_scan_dataset(absRoot, manifestFile).paths();
 }
 
 // Build pairs from two directory roots using file grouping utilities.
 // This uses iqa::utils::group_distorted_by_reference() to associate
 // each reference file with its distorted counterparts.
-std::vector<Pair> load_pairs_from_dirs(const std::string& refsRoot,
-                                              const std::string& distsRoot)
+std::vector<ImagePair> load_pairs_from_dirs(const std::string& refsRoot,
+                                       const std::string& distsRoot,
+                                       const std::string& manifestDir)
 {
     // in iqalab/utils/file_grouping.hpp and file_grouping.cpp.
     //
@@ -86,8 +68,8 @@ std::vector<Pair> load_pairs_from_dirs(const std::string& refsRoot,
     //   std::vector<Group> groups =
     //       iqa::utils::group_distorted_by_reference(refsRoot, distsRoot);
 
-    auto refFiles  = iqa::utils::collect_reference_files(refsRoot);
-    auto distFiles = iqa::utils::collect_distorted_files(distsRoot);
+    auto refFiles  = collect_dataset_files(refsRoot, manifestDir, true);
+    auto distFiles = collect_dataset_files(distsRoot, manifestDir, false);
     auto groups    = iqa::utils::group_distorted_by_reference(refFiles, distFiles);
 
     const std::size_t totalRefs = refFiles.size();
@@ -96,7 +78,7 @@ std::vector<Pair> load_pairs_from_dirs(const std::string& refsRoot,
         exit(1);
     }
 
-    std::vector<Pair> pairs;
+    std::vector<ImagePair> pairs;
     // The following assumes something like:
     //   group.reference_path  -> std::filesystem::path
     //   group.distorted_paths -> std::vector<std::filesystem::path>
@@ -111,64 +93,114 @@ std::vector<Pair> load_pairs_from_dirs(const std::string& refsRoot,
         }
         const auto& distForThisRef = it->second;
         for (const auto& distPath : distForThisRef) {
-            pairs.push_back(Pair{refPath, distPath.string()});
+            pairs.push_back(ImagePair{refPath, distPath});
         }
     }
 
     return pairs;
 }
 
-// Create dilated masks for blur/sharpening measurement.
-BlurRegionMasks make_blur_region_masks(const iqa::RegionMasks& regionMasks,
-                                       int r_flat,
-                                       int r_mid,
-                                       int r_detail)
-{
-    BlurRegionMasks blurMasks;
-
-    auto dilate_if_needed = [](const cv::Mat& srcMask, int r) -> cv::Mat
-    {
-        CV_Assert(srcMask.type() == CV_8U);
-        if (r <= 0)
-        {
-            return srcMask.clone();
-        }
-
-        const int k = 2 * r + 1;
-        cv::Mat kernel = cv::getStructuringElement(
-            cv::MORPH_ELLIPSE,
-            cv::Size(k, k)
-        );
-
-        cv::Mat dst;
-        cv::dilate(srcMask, dst, kernel);
-        return dst;
-    };
-
-    blurMasks.flat   = dilate_if_needed(regionMasks.flat,   r_flat);
-    blurMasks.mid    = dilate_if_needed(regionMasks.mid,    r_mid);
-    blurMasks.detail = dilate_if_needed(regionMasks.detail, r_detail);
-
-    return blurMasks;
-}
-
 void print_usage(const char* argv0)
 {
     std::cerr << "Usage:\n";
     std::cerr << "  " << argv0 << " ref.png dist.png\n";
     std::cerr << "  " << argv0 << " pairs.txt\n";
     std::cerr << "  " << argv0 << " --dirs <refs_root> <dists_root>\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  --region-cache <dir>  reuse region segmentations stored in <dir>\n";
+    std::cerr << "  --dataset-manifest <dir>  scan directory inputs recursively and keep\n"
+              << "                            their listings as manifests in <dir>\n";
+    std::cerr << "  --lab-cache <dir>     keep reference Lab images in <dir> across runs\n";
+    std::cerr << "  --screen <n>          screen pairs at 1/n resolution (2, 4 or 8) first and\n"
+              << "                        analyse only those above a threshold:\n"
+              << "  --screen-mse <t>      promote if reduced BGR MSE >= t (default 2)\n"
+              << "  --screen-blur <t>     promote if reduced blur_L >= t (default 0.05)\n"
+              << "  --screen-blocking <t> promote if reduced dist blocking >= t (default 0.05)\n";
+    std::cerr << "  --timings             print the per-task metric timings of each pair\n";
+    std::cerr << "  --metrics <list>      comma-separated metric columns to compute (default:\n"
+              << "                        all); only their intermediates are computed\n";
 }
 
 int main(int argc, char** argv)
 {
-    if (argc < 3)
+    // Strip options; the remaining arguments are positional.
+    std::string regionCacheDir;
+    std::string manifestDir;
+    std::string labCacheDir;
+    bool screen = false;
+    bool timings = false;
+    iqa::MetricSelection metrics;
+    iqa::ScreeningOptions screenOptions;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string a = argv[i];
+        if (a == "--region-cache" && i + 1 < argc)
+        {
+            regionCacheDir = argv[++i];
+            continue;
+        }
+        if (a == "--dataset-manifest" && i + 1 < argc)
+        {
+            manifestDir = argv[++i];
+            continue;
+        }
+        if (a == "--lab-cache" && i + 1 < argc)
+        {
+            labCacheDir = argv[++i];
+            continue;
+        }
+        if (a == "--screen" && i + 1 < argc)
+        {
+            screen = true;
+            screenOptions.reduction = std::stoi(argv[++i]);
+            continue;
+        }
+        if (a == "--screen-mse" && i + 1 < argc)
+        {
+            screenOptions.mseThreshold = std::stod(argv[++i]);
+            continue;
+        }
+        if (a == "--screen-blur" && i + 1 < argc)
+        {
+            screenOptions.blurThreshold = std::stod(argv[++i]);
+            continue;
+        }
+        if (a == "--screen-blocking" && i + 1 < argc)
+        {
+            screenOptions.blockingThreshold = std::stod(argv[++i]);
+            continue;
+        }
+        if (a == "--metrics" && i + 1 < argc)
+        {
+            try
+            {
+                metrics = iqa::MetricSelection::parse(argv[++i]);
+            }
+            catch (const std::invalid_argument& e)
+            {
+                std::cerr << e.what() << "\nAvailable metrics:\n";
+                for (const std::string& name : iqa::pair_metric_names())
+                    std::cerr << "  " << name << "\n";
+                return 1;
+            }
+            continue;
+        }
+        if (a == "--timings")
+        {
+            timings = true;
+            continue;
+        }
+        args.push_back(a);
+    }
+
+    if (args.size() < 2)
     {
         print_usage(argv[0]);
         return 1;
     }
 
-    std::vector<Pair> pairs;
+    std::vector<ImagePair> pairs;
 
     // Mode 1: single pair of images: ref.png dist.png
 
@@ -176,17 +208,25 @@ int main(int argc, char** argv)
     // as a single reference/distorted pair OR a pairs.txt file.
     // Here we decide:
     //
-    // - if there is an extension ".txt" on argv[1] -> treat as pairs file
+    // - if there is an extension ".txt" on the first argument -> treat as pairs file
     // - else -> treat as single ref/dist pair
-    std::string arg1 = argv[1];
-    std::string arg2 = argv[2];
+    std::string arg1 = args[0];
+    std::string arg2 = args[1];
 
     if (arg1.size() >= 4 &&
         (arg1.compare(arg1.size() - 4, 4, ".txt") == 0 ||
          arg1.compare(arg1.size() - 4, 4, ".lst") == 0))
     {
         // pairs.txt mode
-        pairs = load_pairs_from_file(arg1);
+        try
+        {
+            pairs = iqa::utils::load_pairs_from_file(arg1);
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
         if (pairs.empty())
         {
             std::cerr << "No pairs loaded from file: " << arg1 << "\n";
@@ -202,11 +242,11 @@ int main(int argc, char** argv)
         bool distIsDir  = fs::is_directory(arg2);
 
         if (refIsFile && distIsFile) {
-            pairs.push_back(Pair{arg1, arg2});
+            pairs.push_back(ImagePair{arg1, arg2});
         } else if (refIsDir && distIsDir) {
             std::string refsRoot  = arg1;
             std::string distsRoot = arg2;
-            pairs = load_pairs_from_dirs(refsRoot, distsRoot);
+            pairs = load_pairs_from_dirs(refsRoot, distsRoot, manifestDir);
             if (pairs.empty())
             {
                 std::cerr << "No pairs built from directories: "
@@ -225,7 +265,46 @@ int main(int argc, char** argv)
         }
     }
 
-    auto regionProvider = iqa::make_default_region_provider();
+    // Triage: cheap proxies on reduced decodes; only promoted pairs get the
+    // full-resolution analysis below.
+    const std::size_t totalPairs = pairs.size();
+    if (screen)
+    {
+        const auto screenStart = std::chrono::steady_clock::now();
+        const std::vector<iqa::ScreeningResult> screened = iqa::screen_pairs(pairs, screenOptions);
+        const double screenSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - screenStart).count();
+
+        std::vector<ImagePair> promoted;
+        std::size_t unreadable = 0;
+        std::size_t mismatched = 0;
+        for (std::size_t i = 0; i < pairs.size(); ++i)
+        {
+            if (!screened[i].readable)
+                ++unreadable;
+            else if (screened[i].sizeMismatch)
+                ++mismatched;
+            if (screened[i].promoted)
+                promoted.push_back(std::move(pairs[i]));
+        }
+        pairs = std::move(promoted);
+
+        std::cerr << "screening: " << totalPairs << " pairs at 1/" << screenOptions.reduction
+                  << " in " << screenSeconds << " s, " << pairs.size() << " promoted ("
+                  << unreadable << " unreadable, " << mismatched << " size mismatch)\n";
+    }
+    const std::size_t analysedPairs = pairs.size();
+    const auto analysisStart = std::chrono::steady_clock::now();
+
+    std::shared_ptr<const iqa::RegionProvider> regionProvider =
+        iqa::make_default_region_provider();
+    std::shared_ptr<const iqa::CachedRegionProvider> regionCache;
+    if (!regionCacheDir.empty())
+    {
+        regionCache = std::make_shared<iqa::CachedRegionProvider>(regionProvider,
+                                                                  regionCacheDir);
+        regionProvider = regionCache;
+    }
 
     // CSV header.
 //
@@ -236,128 +315,94 @@ int main(int argc, char** argv)
 // - sharpening in L and a+b per region,
 // - halo metrics in L and a+b on detail edges,
 // - MSE in L and combined MSE in a+b (MSE_ab) globally and per region.
-std::cout
-    << "ref_path,dist_path,"
-    << "n_region_flat,n_region_mid,n_region_detail,"
-    << "n_blur_flat,n_blur_mid,n_blur_detail,"
-    << "blur_L_flat,blur_L_mid,blur_L_detail,"
-    << "blur_ab_flat,blur_ab_mid,blur_ab_detail,"
-    << "sharp_L_flat,sharp_L_mid,sharp_L_detail,"
-    << "sharp_ab_flat,sharp_ab_mid,sharp_ab_detail,"
-    << "halo_L_strength_detail,halo_L_fraction_detail,halo_L_width_detail,"
-    << "halo_ab_strength_detail,halo_ab_fraction_detail,halo_ab_width_detail,"
-    << "mse_L_all,mse_ab_all,"
-    << "mse_L_flat,mse_L_mid,mse_L_detail,"
-    << "mse_ab_flat,mse_ab_mid,mse_ab_detail"
-    << "\n";
-
-for (const auto& p : pairs)
+iqa::write_pair_metrics_csv_header(std::cout, metrics);
+
+// References repeat across consecutive pairs; keep their Lab decoded.
+iqa::ImageCache imageCache;
+std::unique_ptr<iqa::Lab32DiskCache> labDiskCache;
+if (!labCacheDir.empty())
 {
-    cv::Mat labRef, labDist;
-    if (!load_image_lab32(p.refPath, labRef) ||
-        !load_image_lab32(p.distPath, labDist))
+    labDiskCache = std::make_unique<iqa::Lab32DiskCache>(labCacheDir,
+                                                         iqa::Lab32DiskCache::Storage::Float16);
+    imageCache.set_disk_cache(labDiskCache.get());
+}
+
+// Decode and Lab conversion run on worker threads ahead of the metrics.
+iqa::PairPrefetchOptions prefetchOptions;
+prefetchOptions.format = iqa::PairImageFormat::Lab32;
+prefetchOptions.refCache = &imageCache;
+
+// The metrics of each pair run as a task graph. The cores left beside the
+// decode workers are split between graph workers and the OpenCV threads
+// inside each task, so the two levels do not oversubscribe the machine.
+const iqa::ExecutionPolicy policy;
+const iqa::PairGraphPlan graphPlan = policy.plan_pair_graph(
+    iqa::pair_metrics_graph_width(metrics), prefetchOptions.workers);
+const iqa::ScopedCvThreads cvThreads(graphPlan.cvThreads);
+iqa::utils::ThreadPool metricPool(graphPlan.graphWorkers);
+
+iqa::PairPrefetcher prefetcher(std::move(pairs), prefetchOptions);
+iqa::PairMetricsTimings pairTimings;
+
+iqa::LoadedPair loaded;
+while (prefetcher.next(loaded))
+{
+    const ImagePair& p = loaded.paths;
+    const cv::Mat& labRef  = loaded.ref;
+    const cv::Mat& labDist = loaded.dist;
+    if (loaded.sizeMismatch)
+    {
+        std::cerr << "Size mismatch: " << p.refPath.string()
+                  << " vs " << p.distPath.string() << "\n";
+        continue;
+    }
+    if (labRef.empty() || labDist.empty())
     {
+        std::cerr << "Cannot read image: "
+                  << (labRef.empty() ? p.refPath : p.distPath).string() << "\n";
         continue;
     }
 
     if (labRef.size() != labDist.size())
     {
-        std::cerr << "Size mismatch: " << p.refPath
-                  << " vs " << p.distPath << "\n";
+        std::cerr << "Size mismatch: " << p.refPath.string()
+                  << " vs " << p.distPath.string() << "\n";
         continue;
     }
 
-    // Region masks on reference (Lab).
-    iqa::RegionMasks regionMasks = iqa::compute_region_masks(labRef);
-
-    // Pixel counts for original regions.
-    double n_region_flat   = static_cast<double>(cv::countNonZero(regionMasks.flat));
-    double n_region_mid    = static_cast<double>(cv::countNonZero(regionMasks.mid));
-    double n_region_detail = static_cast<double>(cv::countNonZero(regionMasks.detail));
-
-    // Dilated masks for blur/sharpening.
-    const int r_flat   = 1;
-    const int r_mid    = 2;
-    const int r_detail = 3;
-
-    BlurRegionMasks blurMasks = make_blur_region_masks(regionMasks,
-                                                       r_flat,
-                                                       r_mid,
-                                                       r_detail);
-
-    // Pixel counts for blur masks.
-    double n_blur_flat   = static_cast<double>(cv::countNonZero(blurMasks.flat));
-    double n_blur_mid    = static_cast<double>(cv::countNonZero(blurMasks.mid));
-    double n_blur_detail = static_cast<double>(cv::countNonZero(blurMasks.detail));
-
-    // Blur in L per region (dilated masks).
-    double blur_L_flat   = iqa::blur::relative_blur_L(labRef, labDist, blurMasks.flat);
-    double blur_L_mid    = iqa::blur::relative_blur_L(labRef, labDist, blurMasks.mid);
-    double blur_L_detail = iqa::blur::relative_blur_L(labRef, labDist, blurMasks.detail);
-
-    // Blur in a+b per region.
-    double blur_ab_flat   = iqa::blur::relative_blur_ab(labRef, labDist, blurMasks.flat);
-    double blur_ab_mid    = iqa::blur::relative_blur_ab(labRef, labDist, blurMasks.mid);
-    double blur_ab_detail = iqa::blur::relative_blur_ab(labRef, labDist, blurMasks.detail);
-
-    // Sharpening in L per region.
-    double sharp_L_flat   = iqa::blur::relative_sharp_L(labRef, labDist, blurMasks.flat);
-    double sharp_L_mid    = iqa::blur::relative_sharp_L(labRef, labDist, blurMasks.mid);
-    double sharp_L_detail = iqa::blur::relative_sharp_L(labRef, labDist, blurMasks.detail);
-
-    // Sharpening in a+b per region.
-    double sharp_ab_flat   = iqa::blur::relative_sharp_ab(labRef, labDist, blurMasks.flat);
-    double sharp_ab_mid    = iqa::blur::relative_sharp_ab(labRef, labDist, blurMasks.mid);
-    double sharp_ab_detail = iqa::blur::relative_sharp_ab(labRef, labDist, blurMasks.detail);
-
-    // Halo metrics (L and a+b) on detail edges.
-    iqa::halo::HaloMetrics halo =
-        iqa::halo::compute_halo_metrics(labRef, labDist, regionMasks.detail);
-
-    // Global MSE in Lab channels.
-    double mse_L_all = iqa::mse::lab_channel_mse(labRef, labDist, 0);
-    double mse_a_all = iqa::mse::lab_channel_mse(labRef, labDist, 1);
-    double mse_b_all = iqa::mse::lab_channel_mse(labRef, labDist, 2);
-
-    double mse_ab_all = mse_a_all + mse_b_all;
-
-    // Per-region MSE (original masks).
-    double mse_L_flat   = iqa::mse::lab_channel_mse(labRef, labDist, 0, regionMasks.flat);
-    double mse_L_mid    = iqa::mse::lab_channel_mse(labRef, labDist, 0, regionMasks.mid);
-    double mse_L_detail = iqa::mse::lab_channel_mse(labRef, labDist, 0, regionMasks.detail);
-
-    double mse_a_flat   = iqa::mse::lab_channel_mse(labRef, labDist, 1, regionMasks.flat);
-    double mse_a_mid    = iqa::mse::lab_channel_mse(labRef, labDist, 1, regionMasks.mid);
-    double mse_a_detail = iqa::mse::lab_channel_mse(labRef, labDist, 1, regionMasks.detail);
-
-    double mse_b_flat   = iqa::mse::lab_channel_mse(labRef, labDist, 2, regionMasks.flat);
-    double mse_b_mid    = iqa::mse::lab_channel_mse(labRef, labDist, 2, regionMasks.mid);
-    double mse_b_detail = iqa::mse::lab_channel_mse(labRef, labDist, 2, regionMasks.detail);
-
-    double mse_ab_flat   = mse_a_flat   + mse_b_flat;
-    double mse_ab_mid    = mse_a_mid    + mse_b_mid;
-    double mse_ab_detail = mse_a_detail + mse_b_detail;
-
-    std::cout
-        << p.refPath << "," << p.distPath << ","
-        << n_region_flat << "," << n_region_mid << "," << n_region_detail << ","
-        << n_blur_flat << "," << n_blur_mid << "," << n_blur_detail << ","
-        << blur_L_flat << "," << blur_L_mid << "," << blur_L_detail << ","
-        << blur_ab_flat << "," << blur_ab_mid << "," << blur_ab_detail << ","
-        << sharp_L_flat << "," << sharp_L_mid << "," << sharp_L_detail << ","
-        << sharp_ab_flat << "," << sharp_ab_mid << "," << sharp_ab_detail << ","
-        << halo.halo_L_strength_detail << ","
-        << halo.halo_L_fraction_detail << ","
-        << halo.halo_L_width_detail << ","
-        << halo.halo_ab_strength_detail << ","
-        << halo.halo_ab_fraction_detail << ","
-        << halo.halo_ab_width_detail << ","
-        << mse_L_all << "," << mse_ab_all << ","
-        << mse_L_flat << "," << mse_L_mid << "," << mse_L_detail << ","
-        << mse_ab_flat << "," << mse_ab_mid << "," << mse_ab_detail
-        << "\n";
+    const iqa::PairMetrics pairMetrics = iqa::compute_pair_metrics(
+        labRef, labDist, *regionProvider, metricPool, timings ? &pairTimings : nullptr, metrics);
+    iqa::write_pair_metrics_csv_row(std::cout, p.refPath, p.distPath, pairMetrics, metrics);
+    if (timings)
+    {
+        std::cerr << "timings: " << p.distPath.string() << "\n";
+        iqa::write_pair_metrics_timings(std::cerr, pairTimings);
+    }
+    }
+
+    if (screen)
+    {
+        const double analysisSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - analysisStart).count();
+        std::cerr << "full analysis: " << analysedPairs << " of " << totalPairs
+                  << " pairs in " << analysisSeconds << " s\n";
     }
 
+    iqa::write_image_cache_stats(std::cerr, imageCache.stats());
+
+    if (labDiskCache)
+    {
+        const iqa::Lab32DiskCache::Stats st = labDiskCache->stats();
+        std::cerr << "lab cache: " << st.hits << " hits, " << st.misses << " converted ("
+                  << st.stale << " outdated)\n";
+    }
+
+    if (regionCache)
+    {
+        const iqa::CachedRegionProvider::Stats st = regionCache->stats();
+        std::cerr << "region cache: " << st.memoryHits << " memory hits, "
+                  << st.diskHits << " disk hits, " << st.misses << " computed\n";
+    }
 
     return 0;
 }
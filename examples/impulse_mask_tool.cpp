@@ -5,8 +5,10 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "iqalab/image_cache.hpp"
 #include "iqalab/image_type.hpp"          // stem_lower, is_supported_image
 #include "iqalab/impulse.hpp"             // impulse_to_mask(...)
+#include "iqalab/pair_pipeline.hpp"
 #include "iqalab/utils/file_grouping.hpp" // collect_reference_files, ...
 #include "iqalab/utils/path_utils.hpp"
 
@@ -110,6 +112,9 @@ static void process_directory_mode(const CliOptions& opts)
 
     fs::create_directories(outDir);
 
+    // Decoded references; hit/miss counts are reported at the end.
+    ImageCache imageCache;
+
     auto refFiles  = collect_reference_files(refDir);
     auto distFiles = collect_distorted_files(distDir);
     auto groups    = group_distorted_by_reference(refFiles, distFiles);
@@ -121,55 +126,78 @@ static void process_directory_mode(const CliOptions& opts)
     }
 
     for (std::size_t i = 0; i < totalRefs; ++i) {
-        const fs::path& refPath = refFiles[i];
-        std::string refKey = stem_lower(refPath); // lowercase stem, used as map key
-
-        auto it = groups.find(refKey);
+        const auto it = groups.find(stem_lower(refFiles[i]));
         if (it == groups.end() || it->second.empty()) {
             std::cout << "[ref " << (i + 1) << "/" << totalRefs << "] "
-                      << refPath << " : no matching distorted files\n";
-            continue;
+                      << refFiles[i] << " : no matching distorted files\n";
         }
+    }
 
-        const auto& distForThisRef = it->second;
-
-        std::cout << "[ref " << (i + 1) << "/" << totalRefs << "] "
-                  << refPath << " : " << distForThisRef.size()
-                  << " distorted files\n";
+    std::vector<ImagePair> pairs = pairs_from_groups(refFiles, groups);
+
+    // Decoding runs ahead on worker threads and masks are written by the
+    // writer stage, so the loop below only computes masks.
+    PairPrefetchOptions prefetchOptions;
+    prefetchOptions.refCache = &imageCache;
+    PairPrefetcher prefetcher(std::move(pairs), prefetchOptions);
+    AsyncImageWriter writer;
+
+    LoadedPair pair;
+    fs::path prevRef;
+    std::size_t refNo = 0;
+    while (prefetcher.next(pair)) {
+        const fs::path& refPath  = pair.paths.refPath;
+        const fs::path& distPath = pair.paths.distPath;
+        const cv::Mat& refBGR  = pair.ref;
+        const cv::Mat& distBGR = pair.dist;
+
+        // Pairs keep refFiles order, so a new reference is further on.
+        const bool firstOfRef = refPath != prevRef;
+        if (firstOfRef) {
+            while (refFiles[refNo] != refPath)
+                ++refNo;
+            prevRef = refPath;
+            std::cout << "[ref " << (refNo + 1) << "/" << totalRefs << "] "
+                      << refPath << " : " << groups.at(stem_lower(refPath)).size()
+                      << " distorted files\n";
+        }
 
-        cv::Mat refBGR = cv::imread(refPath.string(), cv::IMREAD_COLOR);
+        if (pair.sizeMismatch) {
+            std::cerr << "  Size mismatch: " << refPath
+                      << " vs " << distPath << "\n";
+            continue;
+        }
         if (refBGR.empty()) {
-            std::cerr << "  ERROR: cannot read ref image: " << refPath << "\n";
+            if (firstOfRef)
+                std::cerr << "  ERROR: cannot read ref image: " << refPath << "\n";
             continue;
         }
-
-        for (const auto& distPath : distForThisRef) {
-            cv::Mat distBGR = cv::imread(distPath.string(), cv::IMREAD_COLOR);
-            if (distBGR.empty()) {
-                std::cerr << "  ERROR: cannot read dist image: " << distPath << "\n";
-                continue;
-            }
-            if (distBGR.size() != refBGR.size()) {
-                std::cerr << "  Size mismatch: " << refPath
-                          << " vs " << distPath << "\n";
-                continue;
-            }
-
-            std::size_t nImp;
-            cv::Mat mask = impulse_to_mask_bgr8(refBGR, distBGR, nImp);
-            // count impulses
-            fs::path outMaskPath = make_mask_output_path(outDir, distPath);
-            fs::create_directories(outMaskPath.parent_path());
-
-            if (!cv::imwrite(outMaskPath.string(), mask)) {
-                std::cerr << "  Failed to write mask: " << outMaskPath << "\n";
-            } else {
-                std::cout << "  " << distPath.filename()
-                          << " -> " << outMaskPath.filename()
-                          << " -> impulses=" << nImp << "\n";
-            }
+        if (distBGR.empty()) {
+            std::cerr << "  ERROR: cannot read dist image: " << distPath << "\n";
+            continue;
+        }
+        if (distBGR.size() != refBGR.size()) {
+            std::cerr << "  Size mismatch: " << refPath
+                      << " vs " << distPath << "\n";
+            continue;
         }
+
+        std::size_t nImp;
+        cv::Mat mask = impulse_to_mask_bgr8(refBGR, distBGR, nImp);
+        // count impulses
+        fs::path outMaskPath = make_mask_output_path(outDir, distPath);
+        writer.write(outMaskPath, mask);
+
+        std::cout << "  " << distPath.filename()
+                  << " -> " << outMaskPath.filename()
+                  << " -> impulses=" << nImp << "\n";
+    }
+
+    for (const fs::path& failed : writer.finish()) {
+        std::cerr << "  Failed to write mask: " << failed << "\n";
     }
+
+    write_image_cache_stats(std::cerr, imageCache.stats());
 }
 
 int main(int argc, char** argv)
@@ -6,7 +6,9 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "iqalab/image_cache.hpp"
 #include "iqalab/impulse.hpp"
+#include "iqalab/pair_pipeline.hpp"
 #include "iqalab/utils/file_grouping.hpp"
 #include "iqalab/utils/path_utils.hpp"
 
@@ -140,6 +142,9 @@ void process_directory_mode(const CliOptions& opts)
     }
     int csvFlushCounter = 0;
 
+    // Each reference is decoded once and reused across its distorted files.
+    ImageCache imageCache;
+
     // Loading the list of refs
     auto refFiles  = collect_reference_files(refDir);
     auto distFiles = collect_distorted_files(distDir);
@@ -147,70 +152,93 @@ void process_directory_mode(const CliOptions& opts)
 
     const std::size_t totalRefs = refFiles.size();
     for (std::size_t i = 0; i < totalRefs; ++i) {
-        const fs::path& refPath = refFiles[i];
-        std::string refKey = stem_lower(refPath); // klucz w mapie (lowercase stem)
-
-        auto it = groups.find(refKey);
+        const auto it = groups.find(stem_lower(refFiles[i]));
         if (it == groups.end() || it->second.empty()) {
             std::cout << "[ref " << (i + 1) << "/" << totalRefs << "] "
-                      << refPath << " : no matching distorted files\n";
+                      << refFiles[i] << " : no matching distorted files\n";
+        }
+    }
+
+    std::vector<ImagePair> pairs = pairs_from_groups(refFiles, groups);
+
+    // Pairs are decoded on worker threads while the previous ones are
+    // processed; cleaned images are encoded and written by the writer stage.
+    PairPrefetchOptions prefetchOptions;
+    prefetchOptions.refCache = &imageCache;
+    PairPrefetcher prefetcher(std::move(pairs), prefetchOptions);
+    AsyncImageWriter writer;
+
+    LoadedPair pair;
+    fs::path prevRef;
+    std::size_t refNo = 0;
+    while (prefetcher.next(pair)) {
+        const fs::path& refPath  = pair.paths.refPath;
+        const fs::path& distPath = pair.paths.distPath;
+
+        // Pairs keep refFiles order, so a new reference is further on.
+        if (refPath != prevRef) {
+            while (refFiles[refNo] != refPath)
+                ++refNo;
+            prevRef = refPath;
+            std::cout << "[ref " << (refNo + 1) << "/" << totalRefs << "] "
+                      << refPath << " : " << groups.at(stem_lower(refPath)).size()
+                      << " distorted files\n";
+        }
+
+        fs::path outPath = make_output_path_for_dist(outDir, distPath, "_impulses");
+
+        const cv::Mat& refBGR  = pair.ref;
+        const cv::Mat& distBGR = pair.dist;
+
+        if (pair.sizeMismatch) {
+            std::cerr << "Size mismatch: " << refPath
+                      << " vs " << distPath << "\n";
             continue;
         }
+        if (refBGR.empty() || distBGR.empty()) {
+            std::cerr << "ERROR reading pair: " << refPath
+                      << " vs " << distPath << "\n";
+            continue;
+        }
+        if (refBGR.size() != distBGR.size()) {
+            std::cerr << "Size mismatch: " << refPath
+                      << " vs " << distPath << "\n";
+            continue;
+        }
+
+        cv::Mat cleaned;
+        ImpulseStats stats = clean_impulse_image(refBGR, distBGR, cleaned);
+        int impulses = stats.count;
+
+        // CSV: dist filename + impulses
+        csv << distPath.filename().string() << "," << impulses << "\n";
+        csvFlushCounter++;
+        if (csvFlushCounter >= 20) {
+            csv.flush();
+            csvFlushCounter = 0;
+        }
+
+        // Save image if not dry-run and above threshold
+        if (!opts.dry && impulses >= opts.threshold) {
+            writer.write(outPath, cleaned);
+        }
 
-        const auto& distForThisRef = it->second;
-
-        std::cout << "[ref " << (i + 1) << "/" << totalRefs << "] "
-                  << refPath << " : " << distForThisRef.size()
-                  << " distorted files\n";
-
-        for (const auto& distPath : distForThisRef) {
-            fs::path outPath = make_output_path_for_dist(outDir, distPath, "_impulses");
-
-            cv::Mat refBGR  = cv::imread(refPath.string(),  cv::IMREAD_COLOR);
-            cv::Mat distBGR = cv::imread(distPath.string(), cv::IMREAD_COLOR);
-
-            if (refBGR.empty() || distBGR.empty()) {
-                std::cerr << "ERROR reading pair: " << refPath
-                          << " vs " << distPath << "\n";
-                continue;
-            }
-            if (refBGR.size() != distBGR.size()) {
-                std::cerr << "Size mismatch: " << refPath
-                          << " vs " << distPath << "\n";
-                continue;
-            }
-
-            cv::Mat cleaned;
-            ImpulseStats stats = clean_impulse_image(refBGR, distBGR, cleaned);
-            int impulses = stats.count;
-
-            // CSV: dist filename + impulses
-            csv << distPath.filename().string() << "," << impulses << "\n";
-            csvFlushCounter++;
-            if (csvFlushCounter >= 20) {
-                csv.flush();
-                csvFlushCounter = 0;
-            }
-
-            // Save image if not dry-run and above threshold
-            if (!opts.dry && impulses >= opts.threshold) {
-                fs::create_directories(outPath.parent_path());
-                if (!cv::imwrite(outPath.string(), cleaned)) {
-                    std::cerr << "Failed to write: " << outPath << "\n";
-                }
-            }
-
-            std::cout << "  " << distPath.filename()
-                      << " impulses=" << impulses;
-            if (impulses < opts.threshold) {
-                std::cout << " (below threshold, skip)";
-            }
-            if (opts.dry) {
-                std::cout << " [dry-run]";
-            }
-            std::cout << "\n";
+        std::cout << "  " << distPath.filename()
+                  << " impulses=" << impulses;
+        if (impulses < opts.threshold) {
+            std::cout << " (below threshold, skip)";
         }
+        if (opts.dry) {
+            std::cout << " [dry-run]";
+        }
+        std::cout << "\n";
     }
+
+    for (const fs::path& failed : writer.finish()) {
+        std::cerr << "Failed to write: " << failed << "\n";
+    }
+
+    write_image_cache_stats(std::cerr, imageCache.stats());
 }
 
 int main(int argc, char** argv)
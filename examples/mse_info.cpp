@@ -1,4 +1,6 @@
+#include "iqalab/image_cache.hpp"
 #include "iqalab/mse.hpp"
+#include "iqalab/pair_pipeline.hpp"
 
 #include <filesystem>
 #include <fstream>
@@ -97,6 +99,9 @@ void process_directory_mode(const CliOptions& opts)
     }
     int csvFlushCounter = 0;
 
+    // References are decoded once and reused for all their distorted files.
+    ImageCache imageCache;
+
     // Loading the list of refs
     auto refFiles  = collect_reference_files(refDir);
     auto distFiles = collect_distorted_files(distDir);
@@ -104,52 +109,72 @@ void process_directory_mode(const CliOptions& opts)
 
     const std::size_t totalRefs = refFiles.size();
     for (std::size_t i = 0; i < totalRefs; ++i) {
-        const fs::path& refPath = refFiles[i];
-        std::string refKey = stem_lower(refPath); // klucz w mapie (lowercase stem)
-
-        auto it = groups.find(refKey);
+        const auto it = groups.find(stem_lower(refFiles[i]));
         if (it == groups.end() || it->second.empty()) {
             std::cout << "[ref " << (i + 1) << "/" << totalRefs << "] "
-                      << refPath << " : no matching distorted files\n";
+                      << refFiles[i] << " : no matching distorted files\n";
+        }
+    }
+
+    std::vector<ImagePair> pairs = pairs_from_groups(refFiles, groups);
+
+    // Pairs are decoded on worker threads while the previous ones are scored.
+    PairPrefetchOptions prefetchOptions;
+    prefetchOptions.refCache = &imageCache;
+    PairPrefetcher prefetcher(std::move(pairs), prefetchOptions);
+
+    LoadedPair pair;
+    fs::path prevRef;
+    std::size_t refNo = 0;
+    while (prefetcher.next(pair)) {
+        const fs::path& refPath  = pair.paths.refPath;
+        const fs::path& distPath = pair.paths.distPath;
+
+        // Pairs keep refFiles order, so a new reference is further on.
+        if (refPath != prevRef) {
+            while (refFiles[refNo] != refPath)
+                ++refNo;
+            prevRef = refPath;
+            std::cout << "[ref " << (refNo + 1) << "/" << totalRefs << "] "
+                      << refPath << " : " << groups.at(stem_lower(refPath)).size()
+                      << " distorted files\n";
+        }
+
+        const cv::Mat& refBGR  = pair.ref;
+        const cv::Mat& distBGR = pair.dist;
+
+        if (pair.sizeMismatch) {
+            std::cerr << "Size mismatch: " << refPath
+                      << " vs " << distPath << "\n";
+            continue;
+        }
+        if (refBGR.empty() || distBGR.empty()) {
+            std::cerr << "ERROR reading pair: " << refPath
+                      << " vs " << distPath << "\n";
+            continue;
+        }
+        if (refBGR.size() != distBGR.size()) {
+            std::cerr << "Size mismatch: " << refPath
+                      << " vs " << distPath << "\n";
             continue;
         }
 
-        const auto& distForThisRef = it->second;
-
-        std::cout << "[ref " << (i + 1) << "/" << totalRefs << "] "
-                  << refPath << " : " << distForThisRef.size()
-                  << " distorted files\n";
-
-        for (const auto& distPath : distForThisRef) {
-            cv::Mat refBGR  = cv::imread(refPath.string(),  cv::IMREAD_COLOR);
-            cv::Mat distBGR = cv::imread(distPath.string(), cv::IMREAD_COLOR);
-
-            if (refBGR.empty() || distBGR.empty()) {
-                std::cerr << "ERROR reading pair: " << refPath
-                          << " vs " << distPath << "\n";
-                continue;
-            }
-            if (refBGR.size() != distBGR.size()) {
-                std::cerr << "Size mismatch: " << refPath
-                          << " vs " << distPath << "\n";
-                continue;
-            }
-
-            auto mse = mse::compute_mse(refBGR, distBGR);
-
-            // CSV: dist filename
-            csv << distPath.filename().string() << "," << mse
-                                                << "," << sqrt(mse) << "\n";
-            csvFlushCounter++;
-            if (csvFlushCounter >= 20) {
-                csv.flush();
-                csvFlushCounter = 0;
-            }
-
-            std::cout << "  " << distPath.filename()
-                      << " mse=" << mse << "rmse=" << sqrt(mse) << "\n";
+        auto mse = mse::compute_mse(refBGR, distBGR);
+
+        // CSV: dist filename
+        csv << distPath.filename().string() << "," << mse
+                                            << "," << sqrt(mse) << "\n";
+        csvFlushCounter++;
+        if (csvFlushCounter >= 20) {
+            csv.flush();
+            csvFlushCounter = 0;
         }
+
+        std::cout << "  " << distPath.filename()
+                  << " mse=" << mse << "rmse=" << sqrt(mse) << "\n";
     }
+
+    write_image_cache_stats(std::cerr, imageCache.stats());
 }
 
 int main(int argc, char** argv)
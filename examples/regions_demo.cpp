@@ -57,7 +57,7 @@ fs::path make_output_path(const fs::path& outBaseDir,
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 
-#include <iqalab/region_blocks.hpp>   // BlockGrid16, BlockRegionMasks, ...
+#include <iqalab/region_blocks.hpp>   // BlockGrid16, BlockClass, ...
 #include <iqalab/region_provider.hpp> // or wherever RegionProvider / RegionMasks live
 #include <iqalab/color.hpp>   // bgr8_to_lab32f
 #include <iqalab/visualize_regions.hpp>
@@ -83,46 +83,33 @@ void process_single_file(
     // 3) Compute pixel-level region masks.
     iqa::RegionMasks masks = rp.compute_regions(labRef);
 
-    // Sanity checks: all masks must match image size.
-    CV_Assert(masks.flat.size()   == bgr.size());
-    CV_Assert(masks.mid.size()    == bgr.size());
-    CV_Assert(masks.detail.size() == bgr.size());
-    CV_Assert(masks.flat.type()   == CV_8UC1);
-    CV_Assert(masks.mid.type()    == CV_8UC1);
-    CV_Assert(masks.detail.type() == CV_8UC1);
+    // Sanity checks: label map must match image size.
+    CV_Assert(masks.labels.size() == bgr.size());
+    CV_Assert(masks.labels.type() == CV_8UC1);
 
     // 4) Visualize pixel-level regions (existing behaviour).
     cv::Mat visPixel = visualize_regions(bgr, masks);
 
-    // 5) Build block-level masks (16x16) from pixel masks.
+    // 5) Classify 16x16 blocks directly from the label map.
     //
-    // NOTE: RegionMasks order is:
-    //   - masks.flat
-    //   - masks.detail
-    //   - masks.mid
-    //
-    // Our block-building function expects:
-    //   (flatMask, midMask, detailMask)
-    //
-    // so we pass masks.mid as "mid".
+    // The result is a compact blocksY x blocksX grid of BlockClass values;
+    // no full-size block masks are built.
     using namespace iqa::regions;
 
     const int blockSize = 16;
     BlockGrid16 grid = make_block16_grid(bgr.size(), blockSize);
 
-    BlockRegionMasks blockMasks =
-        make_block_region_masks_from_pixel_masks(
+    cv::Mat1b blockClasses =
+        classify_blocks_from_labels(
             grid,
-            masks.flat,    // flat
-            masks.mid,     // mid
-            masks.detail,  // detail
+            masks.labels,
             0.5,           // minDominantFrac
             0.3            // strongPairFrac: flat+detail large, mid small -> classify as mid
         );
 
     // 6) Visualize block-level classification.
     //
-    // Here we draw coloured rectangles per block, based on which block mask is set.
+    // Here we draw coloured rectangles per block, based on the block class.
     cv::Mat visBlock = bgr.clone();
 
     for (int by = 0; by < grid.blocksY; ++by) {
@@ -132,30 +119,25 @@ void process_single_file(
             if (r.width <= 0 || r.height <= 0)
                 continue;
 
-            // Because make_block_region_masks_from_pixel_masks() fills whole block
-            // uniformly with 255 in exactly one of the masks (or leaves all zero),
-            // we can check a single pixel in the ROI to infer the class.
-            cv::Mat1b flatROI   = blockMasks.flat(r);
-            cv::Mat1b midROI    = blockMasks.mid(r);
-            cv::Mat1b detailROI = blockMasks.detail(r);
-
-            const bool isFlat   = (flatROI.at<uchar>(0, 0)   == 255);
-            const bool isMid    = (midROI.at<uchar>(0, 0)    == 255);
-            const bool isDetail = (detailROI.at<uchar>(0, 0) == 255);
-
             cv::Scalar color;
-            if (isFlat) {
+            switch (static_cast<BlockClass>(blockClasses(by, bx))) {
+            case BlockClass::Flat:
                 // Blue for flat.
                 color = cv::Scalar(255, 0, 0);
-            } else if (isMid) {
+                break;
+            case BlockClass::Mid:
                 // Yellow for mid.
                 color = cv::Scalar(0, 255, 255);
-            } else if (isDetail) {
+                break;
+            case BlockClass::Detail:
                 // Red for detail.
                 color = cv::Scalar(0, 0, 255);
-            } else {
+                break;
+            case BlockClass::None:
+            default:
                 // Gray for unclassified blocks.
                 color = cv::Scalar(128, 128, 128);
+                break;
             }
 
             cv::rectangle(visBlock, r, color, 1);
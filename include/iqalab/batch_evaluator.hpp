@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "iqalab/execution_policy.hpp"
+#include "iqalab/image_cache.hpp"
+#include "iqalab/pair_metrics.hpp"
+#include "iqalab/region_provider.hpp"
+#include "iqalab/utils/file_grouping.hpp"
+
+namespace iqa
+{
+
+class Lab32DiskCache;
+
+struct BatchOptions
+{
+    // Core budget and the split between pair-level and image-level
+    // parallelism (see ExecutionPolicy).
+    ExecutionPolicyOptions execution;
+    // Segmentation of the references; nullptr: make_default_region_provider().
+    std::shared_ptr<const RegionProvider> regions;
+    // Metric columns to compute and write; default: all.
+    MetricSelection metrics;
+    std::size_t imageCacheBytes = ImageCache::kDefaultByteBudget;
+    Lab32DiskCache* labCache = nullptr;   // optional, must outlive the evaluator
+};
+
+struct BatchSummary
+{
+    std::size_t pairs = 0;
+    std::size_t scored = 0;
+    std::size_t failed = 0;   // unreadable, size mismatch or metric error
+    double seconds = 0.0;
+};
+
+// Scores (reference, distorted) pairs with the blur_mse_info metric set
+// (compute_pair_metrics) on a work-stealing utils::ThreadPool.
+//
+// Each pair is one task: decode, Lab conversion and metrics. An
+// ExecutionPolicy plans the batch first: huge images are scored one at a
+// time with OpenCV's internal threading, then the rest run across the
+// pool (see ExecutionPolicy for the thread split). References are shared
+// through an ImageCache, so pairs of one reference that run concurrently
+// decode it once. Finished rows go into per-pair slots published with an
+// atomic flag; the calling thread drains them in input order, so the CSV
+// is identical for any thread count. Failed pairs are reported on `log`
+// in the same order and left out of the CSV.
+class BatchEvaluator
+{
+public:
+    explicit BatchEvaluator(BatchOptions options = BatchOptions());
+
+    // Writes the CSV header and one row per scored pair to `csv`. Blocks
+    // until all pairs are done. `log` may be nullptr.
+    BatchSummary run(const std::vector<utils::ImagePair>& pairs,
+                     std::ostream& csv,
+                     std::ostream* log = nullptr);
+
+    const ImageCache& image_cache() const { return m_imageCache; }
+
+private:
+    BatchOptions m_options;
+    ImageCache m_imageCache;
+};
+
+} // namespace iqa
@@ -2,6 +2,9 @@
 
 #include <opencv2/core/mat.hpp>
 
+#include "iqalab/utils/bit_mask.hpp"
+#include "iqalab/utils/mask_spans.hpp"
+
 namespace iqa::blur
 {
 
@@ -31,4 +34,51 @@ double relative_sharp_ab(const cv::Mat& labRef,
                          const cv::Mat& mask = cv::Mat(),
                          double eps = 1e-6);
 
+// Span-indexed variants of the functions above.
+//
+// Gradients are evaluated only at pixels covered by `spans` (same
+// Gaussian 3x3 + Sobel 3x3 with replicated borders as the full-image path),
+// so the cost scales with mask area instead of image area. Results match the
+// cv::Mat mask overloads up to floating-point rounding.
+double relative_blur_L(const cv::Mat& labRef,
+                       const cv::Mat& labDist,
+                       const MaskSpans& spans,
+                       double eps = 1e-6);
+
+double relative_blur_ab(const cv::Mat& labRef,
+                        const cv::Mat& labDist,
+                        const MaskSpans& spans,
+                        double eps = 1e-6);
+
+double relative_sharp_L(const cv::Mat& labRef,
+                        const cv::Mat& labDist,
+                        const MaskSpans& spans,
+                        double eps = 1e-6);
+
+double relative_sharp_ab(const cv::Mat& labRef,
+                         const cv::Mat& labDist,
+                         const MaskSpans& spans,
+                         double eps = 1e-6);
+
+// Building blocks of the functions above, for callers that evaluate
+// several masks on the same pair: the gradient maps are computed once and
+// only the masked means are repeated.
+//
+// Squared gradient magnitude (CV_32F) after Gaussian 3x3 (sigma 1) and
+// Sobel 3x3 with replicated borders, of L or summed over a and b.
+cv::Mat l_gradient_energy_map(const cv::Mat& lab);
+cv::Mat ab_gradient_energy_map(const cv::Mat& lab);
+
+// Mean of an energy map over mask (CV_8U, 0/255), or over the whole image
+// if the mask is empty; 0 for an empty mask region.
+double mean_gradient_energy(const cv::Mat& energy, const cv::Mat& mask = cv::Mat());
+
+// Same over a bit-packed mask; empty 64-pixel words are skipped.
+double mean_gradient_energy(const cv::Mat& energy, const BitMask& mask);
+
+// Relative blur / sharpening from reference and distorted energies, with
+// the clamping of relative_blur_* / relative_sharp_*.
+double relative_blur_from_energies(double E_ref, double E_dist, double eps = 1e-6);
+double relative_sharp_from_energies(double E_ref, double E_dist, double eps = 1e-6);
+
 } // namespace iqa::blur
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "iqalab/image_type.hpp"
+#include "iqalab/utils/file_grouping.hpp"
+
+namespace iqa
+{
+
+// Where the cores go for one pair.
+enum class ParallelMode
+{
+    AcrossPairs,   // one worker per pair, OpenCV kernels single-threaded
+    WithinImage    // pairs one at a time, OpenCV threads inside the kernels
+};
+
+struct ExecutionPolicyOptions
+{
+    int threads = 0;   // core budget; <= 0: one per hardware thread
+    // Pairs whose distorted image has at least this many pixels (from the
+    // file header) run WithinImage.
+    std::size_t largeImagePixels = 24000000;
+    bool pinThreads = false;   // pin pair workers to cores (Linux only)
+};
+
+// Decisions for one batch.
+struct ExecutionPlan
+{
+    std::vector<ParallelMode> modes;   // per pair, in input order
+    // Probed headers per pair, for the scoring tasks to reuse; each
+    // distinct reference file is probed once.
+    std::vector<ImageInfo> refInfo;
+    std::vector<ImageInfo> distInfo;
+    std::size_t withinImagePairs = 0;
+    int pairWorkers = 1;         // pool size for the AcrossPairs pairs
+    int cvThreadsAcross = 1;     // cv::setNumThreads() while they run
+    int cvThreadsWithin = 1;     // cv::setNumThreads() for WithinImage pairs
+};
+
+// Decisions for scoring pairs one at a time, each pair's metrics as a task
+// graph on a pool (compute_pair_metrics with a utils::ThreadPool).
+struct PairGraphPlan
+{
+    int graphWorkers = 1;   // pool size for the graph tasks
+    int cvThreads = 1;      // cv::setNumThreads() while the pairs run
+};
+
+// Splits a core budget between pair-level and image-level parallelism.
+//
+// OpenCV parallelizes cvtColor, GaussianBlur, Sobel, morphology and
+// iqalab's own cv::parallel_for_ loops internally. Running those from
+// several pair workers at once oversubscribes the machine, while running
+// a few huge images on one worker each leaves cores idle. The plan sends
+// huge images through WithinImage (one pair at a time, all OpenCV
+// threads) and everything else through AcrossPairs (one pool worker per
+// core, OpenCV single-threaded, or split between the pairs when there are
+// fewer pairs than cores).
+//
+// cv::setNumThreads() is process-wide, so the two modes cannot overlap:
+// callers run the WithinImage pairs and the AcrossPairs pairs as separate
+// phases, each under a ScopedCvThreads.
+class ExecutionPolicy
+{
+public:
+    explicit ExecutionPolicy(ExecutionPolicyOptions options = ExecutionPolicyOptions());
+
+    // Reads only the image headers (probe_image) of the files.
+    ExecutionPlan plan(const std::vector<utils::ImagePair>& pairs) const;
+
+    // Splits the cores left after `otherWorkers` busy threads (e.g. decode
+    // prefetchers) between graph tasks and their OpenCV kernels: at most
+    // `graphWidth` graph workers (the tasks that can run at once), the
+    // remaining share as OpenCV threads inside each task.
+    PairGraphPlan plan_pair_graph(int graphWidth, int otherWorkers = 0) const;
+
+    int threads() const { return m_threads; }
+    const ExecutionPolicyOptions& options() const { return m_options; }
+
+    // utils::ThreadPool::WorkerInit body: pins worker `index` to a core
+    // when pinThreads is set, otherwise does nothing.
+    void on_worker_start(int index) const;
+
+private:
+    ExecutionPolicyOptions m_options;
+    int m_threads;
+};
+
+// Sets cv::setNumThreads(n) and restores the previous value on destruction.
+class ScopedCvThreads
+{
+public:
+    explicit ScopedCvThreads(int n);
+    ~ScopedCvThreads();
+
+    ScopedCvThreads(const ScopedCvThreads&) = delete;
+    ScopedCvThreads& operator=(const ScopedCvThreads&) = delete;
+
+private:
+    int m_previous;
+};
+
+// Pin the calling thread to the index-th CPU it is allowed to run on
+// (modulo their count). Returns false where unsupported or on failure.
+bool pin_current_thread(int index);
+
+} // namespace iqa
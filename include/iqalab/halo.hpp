@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 #include <opencv2/core/mat.hpp>
 
 namespace iqa::halo
@@ -17,6 +19,21 @@ struct HaloMetrics
   double halo_ab_strength_detail = 0.0; // mean absolute chroma halo strength (Lab units)
   double halo_ab_fraction_detail = 0.0; // fraction of strong edges with chromatic halo
   double halo_ab_width_detail    = 0.0; // average halo width in a+b (pixels)
+
+  // Work counters (not metrics): strong edge pixels accepted as edge points
+  // and 1D profiles actually sampled on them.
+  std::size_t edge_points        = 0;
+  std::size_t profiles_evaluated = 0;
+};
+
+// Optional behaviour switches for compute_halo_metrics().
+struct HaloOptions
+{
+  // Canny-style non-maximum suppression: keep only edge pixels whose
+  // gradient magnitude is a local maximum along the gradient direction.
+  // Thick edges then yield one profile across instead of 3-5 near-identical
+  // ones. Off by default to keep the classic edge-point statistics.
+  bool thinEdges = false;
 };
 
 // Compute halo metrics on the detail region.
@@ -25,15 +42,24 @@ struct HaloMetrics
 //   - reference and distorted images in Lab32 (CV_32FC3), same size.
 // detailMask:
 //   - CV_8U mask (0/255) marking detail region (where to search for edges).
+// options:
+//   - see HaloOptions (edge thinning).
 //
 // The function:
 //   - finds strong edges in L within detailMask (percentile-based threshold),
-//   - for each edge pixel samples a 1D profile along the normal to the edge,
+//   - for each edge pixel samples a 1D profile along the normal to the edge
+//     (normal quantized to a fixed set of directions with precomputed
+//     integer offsets; nearest-neighbour sampling),
 //   - measures luminance halo (overshoot/undershoot relative to local contrast),
 //   - measures chromatic halo (magnitude of a+b deviation),
 //   - aggregates per-edge values into HaloMetrics.
+//
+// Edge pixels are processed in parallel (cv::parallel_for_) over fixed row
+// bands; per-band sums are reduced in a fixed order, so the result does not
+// depend on the number of threads.
 HaloMetrics compute_halo_metrics(const cv::Mat& labRef,
                                  const cv::Mat& labDist,
-                                 const cv::Mat& detailMask);
+                                 const cv::Mat& detailMask,
+                                 const HaloOptions& options = HaloOptions());
 
 } // namespace iqa::halo
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <opencv2/core/mat.hpp>
+
+namespace iqa
+{
+
+// In-process cache of decoded images for batch tools.
+//
+// Directory modes pair one reference with many distorted files; without a
+// cache the reference is decoded again for every pair. Entries are keyed by
+// path and validated against the file's mtime and size on every lookup (one
+// stat), so a file rewritten during a run is decoded again.
+//
+// Each entry holds the decoded BGR (CV_8UC3, cv::IMREAD_COLOR) and, once
+// requested, its Lab32 version (8-bit cv::COLOR_BGR2Lab converted to
+// CV_32FC3, as in the CLI tools). Memory is bounded by `byteBudget` over
+// all pixel buffers; least recently used entries are evicted first. An
+// image larger than the whole budget is returned but not kept.
+//
+// With a Lab32DiskCache attached, Lab images missing from memory are read
+// from (and written to) the disk cache instead of being decoded and
+// converted; such entries hold no BGR until load_bgr() asks for it.
+//
+// Returned matrices share pixel buffers with the cache: clone them before
+// modifying. All member functions may be called from several threads;
+// decoding happens outside the lock.
+class Lab32DiskCache;
+
+class ImageCache
+{
+public:
+    static constexpr std::size_t kDefaultByteBudget = std::size_t(512) << 20;
+
+    struct Stats
+    {
+        std::size_t hits = 0;        // served from memory
+        std::size_t misses = 0;      // decoded from the image file
+        std::size_t diskHits = 0;    // Lab read from the Lab32DiskCache
+        std::size_t failed = 0;      // missing or unreadable file
+        std::size_t evictions = 0;
+        std::size_t bytes = 0;       // currently held
+        std::size_t entries = 0;
+    };
+
+    explicit ImageCache(std::size_t byteBudget = kDefaultByteBudget);
+
+    // Decoded BGR image; empty if the file cannot be read.
+    cv::Mat load_bgr(const std::filesystem::path& path);
+
+    // Lab32 image (derived from the cached BGR); empty if unreadable.
+    cv::Mat load_lab32(const std::filesystem::path& path);
+
+    // Persistent Lab store consulted by load_lab32(); nullptr (the default)
+    // disables it. Set before the cache is shared between threads; the
+    // store must outlive this cache.
+    void set_disk_cache(Lab32DiskCache* diskCache) { m_diskCache = diskCache; }
+
+    Stats stats() const;
+    void clear();
+
+    std::size_t byte_budget() const { return m_byteBudget; }
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::int64_t mtime = 0;
+        std::uintmax_t fileSize = 0;
+        cv::Mat bgr;
+        cv::Mat lab32;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    // Look up a current entry and move it to the front; m_mutex must be held.
+    Entry* find_locked(const std::string& key, std::int64_t mtime, std::uintmax_t fileSize);
+
+    // Insert or replace an entry, then evict down to the budget.
+    void store_locked(Entry entry);
+
+    void erase_locked(EntryList::iterator it);
+    void evict_locked();
+
+    std::size_t m_byteBudget;
+    Lab32DiskCache* m_diskCache = nullptr;
+
+    mutable std::mutex m_mutex;
+    EntryList m_entries;   // most recently used first
+    std::unordered_map<std::string, EntryList::iterator> m_index;
+    Stats m_stats;
+};
+
+// Lab32 as returned by ImageCache::load_lab32(): 8-bit cv::COLOR_BGR2Lab
+// (all channels 0..255) converted to CV_32FC3. Note that bgr8_to_lab32f()
+// from color.hpp uses the float conversion (L in 0..100) instead.
+cv::Mat lab32_from_bgr8(const cv::Mat& bgr);
+
+// lab32_from_bgr8(read_image_bgr(path)). Raw BMP / PNM files are converted
+// straight from their mapping (map_raw_image), with no owning BGR copy in
+// between. Returns an empty Mat if the file cannot be read.
+cv::Mat read_image_lab32(const std::filesystem::path& path);
+
+// One "image cache: <hits> hits, <decoded> decoded, ..." line, as the CLI
+// tools report at the end of a run.
+void write_image_cache_stats(std::ostream& os, const ImageCache::Stats& stats);
+
+} // namespace iqa
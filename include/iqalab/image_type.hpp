@@ -25,4 +25,30 @@ ImageType get_image_type(const std::string& path);
 
 bool is_image_file(const std::string& path);
 
+// Header-level facts about an image file, read without decoding pixels.
+struct ImageInfo {
+  ImageType type = ImageType::Unknown; // from the file signature, not the extension
+  int width = 0;
+  int height = 0;
+  int channels = 0;  // channels of the decoded image (palette -> 3)
+  int bitDepth = 0;  // bits per channel
+
+  bool has_size() const { return width > 0 && height > 0; }
+};
+
+// Parse the signature and header of `p`: JPEG SOF, PNG IHDR, BMP info
+// header, TIFF first IFD, WebP VP8/VP8L/VP8X, GIF screen descriptor and
+// PNM header. Only header bytes are read (JPEG segments and the TIFF IFD
+// are reached by seeking). `type` is Unknown for unrecognized files;
+// JPEG 2000 / AVIF are recognized but not sized. Fields stay 0 when the
+// header is missing or truncated.
+ImageInfo probe_image(const std::filesystem::path& p);
+
+// True if two probed images certainly decode to different sizes. Header
+// sizes are the stored ones, while cv::imread applies the EXIF orientation
+// (e.g. JPEG orientation 5-8 swaps width and height), so unknown sizes and
+// swapped width/height are not conclusive: callers compare the decoded
+// sizes then.
+bool probed_sizes_differ(const ImageInfo& a, const ImageInfo& b);
+
 } // namespace iqa
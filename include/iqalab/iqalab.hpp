@@ -8,6 +8,10 @@ namespace iqa {
 
 double blocking_score(const cv::Mat& bgr);
 
+// blocking_score() with the block grid every `blockSize` pixels (>= 2),
+// e.g. 4 for a JPEG decoded at half resolution.
+double blocking_score(const cv::Mat& bgr, int blockSize);
+
 double blocking_score_from_file(const std::string& distPath);
 
 cv::Mat flat_blocking_to_mask(const cv::Mat& refBGR, const cv::Mat& distBGR);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+
+#include <opencv2/core/mat.hpp>
+
+namespace iqa
+{
+
+// Persistent cache of Lab32 images (lab32_from_bgr8() of the decoded file)
+// shared across runs, so a fixed reference corpus is decoded and converted
+// once.
+//
+// Each source file maps to `cacheDir/<hash of its absolute path>.iqlab`: a
+// 64-byte header (source mtime and size, dimensions, sample storage)
+// followed by the interleaved L,a,b samples with no row padding, i.e. the
+// layout of a continuous CV_32FC3 (or CV_16FC3) matrix. Files are
+// memory-mapped on lookup and copied out; an entry whose source mtime or
+// size no longer matches is recomputed and overwritten.
+//
+// Float16 storage halves the files and is exact here: lab32_from_bgr8()
+// yields integers in 0..255, which half floats represent exactly.
+//
+// Files are written to a temporary name and renamed, so concurrent runs
+// sharing a directory never see partial files; write failures only skip
+// persisting. All member functions may be called from several threads.
+class Lab32DiskCache
+{
+public:
+    enum class Storage
+    {
+        Float32,
+        Float16
+    };
+
+    struct Stats
+    {
+        std::size_t hits = 0;     // served from a cache file
+        std::size_t misses = 0;   // decoded and converted
+        std::size_t stale = 0;    // misses that replaced an outdated file
+    };
+
+    // Creates cacheDir if needed (throws std::filesystem::filesystem_error
+    // if that fails).
+    explicit Lab32DiskCache(std::filesystem::path cacheDir,
+                            Storage storage = Storage::Float32);
+
+    // CV_32FC3 Lab of `source`, from the cache file when it is current,
+    // otherwise decoded, converted and stored. Empty if the source cannot
+    // be read. `fromFile`, if given, is set to whether the cache file was
+    // used.
+    cv::Mat load_lab32(const std::filesystem::path& source, bool* fromFile = nullptr);
+
+    // Cache file only: false if it is missing, outdated or unreadable.
+    bool lookup(const std::filesystem::path& source, cv::Mat& lab32);
+
+    // Persist `lab32` (CV_32FC3) as the current Lab of `source`.
+    void store(const std::filesystem::path& source, const cv::Mat& lab32);
+
+    Stats stats() const;
+
+    const std::filesystem::path& cache_dir() const { return m_cacheDir; }
+    Storage storage() const { return m_storage; }
+
+    // Cache file that holds the Lab of `source`.
+    std::filesystem::path file_path(const std::filesystem::path& source) const;
+
+private:
+    std::filesystem::path m_cacheDir;
+    Storage m_storage;
+
+    mutable std::mutex m_mutex;
+    Stats m_stats;
+};
+
+} // namespace iqa
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include <opencv2/core/mat.hpp>
+
+#include "iqalab/utils/mapped_file.hpp"
+
+namespace iqa
+{
+
+// Channel layout of MappedImage::pixels (always 8 bits per channel).
+enum class PixelOrder
+{
+    Gray,   // CV_8UC1
+    Bgr,    // CV_8UC3
+    Rgb,    // CV_8UC3 (binary PPM)
+    Bgrx    // CV_8UC4, 4th byte unused (32-bit BMP)
+};
+
+// Raw image read through a memory mapping.
+//
+// When the file layout matches a cv::Mat (binary PNM, top-down BMP),
+// `pixels` is a header pointing into the mapping: no copy, pages are read
+// on first access. `mapping` keeps the file mapped; `pixels` is valid only
+// while a MappedImage (or a copy of `mapping`) is alive. Bottom-up BMPs,
+// the common case, cannot be expressed with a positive step and are
+// copied once with rows reversed (zeroCopy == false, `pixels` owns data).
+struct MappedImage
+{
+    cv::Mat pixels;
+    PixelOrder order = PixelOrder::Bgr;
+    bool zeroCopy = false;
+    std::shared_ptr<const utils::MappedFile> mapping;
+};
+
+// Map an uncompressed BMP (24/32-bit BI_RGB) or a binary PNM (P5/P6,
+// maxval 255). Returns false for any other format or layout (palette
+// BMPs, RLE, PNM with other maxvals, ...), which callers should decode with
+// cv::imread; the signature is checked with a 2-byte read, so those files
+// are not mapped. Throws std::runtime_error if the file cannot be opened
+// or mapped.
+bool map_raw_image(const std::filesystem::path& path, MappedImage& out);
+
+// Equivalent of cv::imread(path, cv::IMREAD_COLOR). The result owns its
+// pixels: raw BMP / PNM files are copied out of the mapping once (with the
+// channel conversion, no codec), everything else goes through cv::imread.
+// Callers that only need Lab should use read_image_lab32() (image_cache.hpp),
+// which converts straight from the mapping without this copy.
+// Returns an empty Mat if the file cannot be read.
+cv::Mat read_image_bgr(const std::filesystem::path& path);
+
+} // namespace iqa
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <vector>
+
 #include <opencv2/core.hpp>
 
+#include "iqalab/utils/mask_spans.hpp"
+
 namespace iqa::mse
 {
 // Simple global MSE on a color image.
@@ -16,4 +20,20 @@ double lab_channel_mse(const cv::Mat& labRef,
                        const cv::Mat& labDist,
                        int channel,
                        const cv::Mat& mask = cv::Mat());
+
+// MSE in Lab for channel over the pixels of a span index
+// (see build_mask_spans); cost scales with mask area, not image area.
+double lab_channel_mse(const cv::Mat& labRef,
+                       const cv::Mat& labDist,
+                       int channel,
+                       const MaskSpans& spans);
+
+// Per-label MSE in Lab for all three channels in a single pass.
+// labels: CV_8U label map (e.g. RegionMasks::labels); pixels with
+// label >= numLabels are ignored. Entry i holds (MSE_L, MSE_a, MSE_b) over
+// pixels with label i, or zeros if that label is empty.
+std::vector<cv::Vec3d> lab_mse_by_label(const cv::Mat& labRef,
+                                        const cv::Mat& labDist,
+                                        const cv::Mat& labels,
+                                        int numLabels);
 }
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "iqalab/halo.hpp"
+#include "iqalab/region_provider.hpp"
+#include "iqalab/utils/task_graph.hpp"
+#include "iqalab/utils/thread_pool.hpp"
+
+namespace iqa
+{
+
+// Full-reference metric set reported per pair by blur_mse_info and
+// batch_eval. Field names are the CSV column names.
+struct PairMetrics
+{
+    // Pixel counts of the flat/mid/detail regions of the reference.
+    double n_region_flat = 0.0, n_region_mid = 0.0, n_region_detail = 0.0;
+
+    // Pixel counts of the dilated region masks used for blur/sharpening.
+    double n_blur_flat = 0.0, n_blur_mid = 0.0, n_blur_detail = 0.0;
+
+    double blur_L_flat = 0.0, blur_L_mid = 0.0, blur_L_detail = 0.0;
+    double blur_ab_flat = 0.0, blur_ab_mid = 0.0, blur_ab_detail = 0.0;
+    double sharp_L_flat = 0.0, sharp_L_mid = 0.0, sharp_L_detail = 0.0;
+    double sharp_ab_flat = 0.0, sharp_ab_mid = 0.0, sharp_ab_detail = 0.0;
+
+    // Halo on detail edges (only the metric fields are reported).
+    halo::HaloMetrics halo;
+
+    // Lab MSE over the whole image and per (undilated) region; "ab" is the
+    // sum of the a and b channel MSEs.
+    double mse_L_all = 0.0, mse_ab_all = 0.0;
+    double mse_L_flat = 0.0, mse_L_mid = 0.0, mse_L_detail = 0.0;
+    double mse_ab_flat = 0.0, mse_ab_mid = 0.0, mse_ab_detail = 0.0;
+};
+
+// Names of all PairMetrics columns, in CSV order.
+const std::vector<std::string>& pair_metric_names();
+
+// Subset of the PairMetrics columns to compute and report.
+//
+// Each metric in the registry declares the intermediates it needs: region
+// masks, dilated blur masks, L and/or a,b gradient energy maps, the halo
+// edge profiles on the detail mask. compute_pair_metrics() adds only the
+// tasks required by the selection, each once; e.g. {"mse_L_all"} skips
+// segmentation, dilation, gradients and halo. Fields not selected are
+// left at 0.
+class MetricSelection
+{
+public:
+    // All metrics.
+    MetricSelection();
+
+    // Throws std::invalid_argument for an unknown name or an empty list.
+    explicit MetricSelection(const std::vector<std::string>& names);
+
+    // Comma-separated names, e.g. "mse_L_all,blur_L_detail".
+    static MetricSelection parse(const std::string& list);
+
+    // Throws std::invalid_argument for an unknown name.
+    bool contains(const std::string& name) const;
+    bool contains(std::size_t index) const { return m_selected[index]; }
+
+    // Selected names, in CSV order.
+    std::vector<std::string> names() const;
+
+private:
+    std::vector<bool> m_selected;   // indexed like pair_metric_names()
+};
+
+// Compute the selected metrics for one pair of Lab32 images (CV_32FC3,
+// same size); regions are segmented on the reference by `regions`.
+PairMetrics compute_pair_metrics(const cv::Mat& labRef,
+                                 const cv::Mat& labDist,
+                                 const RegionProvider& regions,
+                                 const MetricSelection& selection = MetricSelection());
+
+// Per-task breakdown of one compute_pair_metrics() call.
+struct PairMetricsTimings
+{
+    std::vector<utils::TaskGraph::Timing> tasks;   // in graph order
+    double wallMs = 0.0;
+};
+
+// Same metrics, computed as a task graph on `pool` to cut single-pair
+// latency:
+//
+//   regions ----------> mask_{flat,mid,detail} --+--> blur_{flat,mid,detail}
+//      |                                         |
+//      +--> halo, mse_regions                    |
+//   gradients_{ref,dist}_{L,ab} -----------------+
+//   mse_all
+//
+// The gradient energy maps are computed once and shared by the
+// blur/sharpening values; results are identical to the sequential
+// overload. Only the tasks needed by `selection` are added. Blocks until
+// done; must not be called from a task of `pool`. `timings`, if given,
+// receives the per-task start and duration.
+PairMetrics compute_pair_metrics(const cv::Mat& labRef,
+                                 const cv::Mat& labDist,
+                                 const RegionProvider& regions,
+                                 utils::ThreadPool& pool,
+                                 PairMetricsTimings* timings = nullptr,
+                                 const MetricSelection& selection = MetricSelection());
+
+// Most tasks of the graph for `selection` that can be ready at the same
+// time; sizing a pool beyond this leaves workers idle (see
+// ExecutionPolicy::plan_pair_graph).
+int pair_metrics_graph_width(const MetricSelection& selection = MetricSelection());
+
+// One line per task ("  <name>  start <ms>  took <ms>") and the wall time.
+void write_pair_metrics_timings(std::ostream& os, const PairMetricsTimings& timings);
+
+// CSV header (ref_path,dist_path,<selected metric columns>) and one row,
+// each terminated by '\n'.
+void write_pair_metrics_csv_header(std::ostream& os,
+                                   const MetricSelection& selection = MetricSelection());
+
+void write_pair_metrics_csv_row(std::ostream& os,
+                                const std::filesystem::path& refPath,
+                                const std::filesystem::path& distPath,
+                                const PairMetrics& m,
+                                const MetricSelection& selection = MetricSelection());
+
+} // namespace iqa
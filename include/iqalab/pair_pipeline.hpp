@@ -0,0 +1,139 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "iqalab/utils/file_grouping.hpp"
+
+namespace iqa
+{
+
+class ImageCache;
+
+// Decoded form delivered by PairPrefetcher.
+enum class PairImageFormat
+{
+    Bgr8,    // cv::IMREAD_COLOR
+    Lab32    // lab32_from_bgr8() of the above
+};
+
+struct PairPrefetchOptions
+{
+    int workers = 2;                  // decode threads
+    std::size_t queueCapacity = 8;    // decoded pairs held ahead of the consumer
+    PairImageFormat format = PairImageFormat::Bgr8;
+
+    // Optional cache for reference images (must outlive the prefetcher);
+    // distorted images are always decoded directly.
+    ImageCache* refCache = nullptr;
+};
+
+// One decoded pair. ref / dist are empty when the file could not be read.
+struct LoadedPair
+{
+    std::size_t index = 0;   // position in the input list
+    utils::ImagePair paths;
+    cv::Mat ref;
+    cv::Mat dist;
+    // Both headers were readable and report different dimensions; neither
+    // image is decoded in that case (ref and dist stay empty).
+    bool sizeMismatch = false;
+};
+
+// Decodes (ref, dist) pairs on worker threads ahead of the consumer.
+//
+// Workers claim pairs in input order and decode them concurrently; at most
+// queueCapacity pairs are claimed beyond the one the consumer waits for, so
+// memory stays bounded while decoding overlaps with scoring. next() returns
+// pairs strictly in input order.
+//
+//   PairPrefetcher prefetch(pairs, opts);
+//   LoadedPair p;
+//   while (prefetch.next(p)) score(p.ref, p.dist);
+//
+// next() must be called from one thread. Destroying the prefetcher early
+// stops the workers after their current pair.
+class PairPrefetcher
+{
+public:
+    explicit PairPrefetcher(std::vector<utils::ImagePair> pairs,
+                            const PairPrefetchOptions& options = PairPrefetchOptions());
+    ~PairPrefetcher();
+
+    PairPrefetcher(const PairPrefetcher&) = delete;
+    PairPrefetcher& operator=(const PairPrefetcher&) = delete;
+
+    // Next pair in input order; false once all pairs were delivered.
+    bool next(LoadedPair& out);
+
+    std::size_t size() const { return m_pairs.size(); }
+
+private:
+    void worker_loop();
+    LoadedPair decode(std::size_t index) const;
+
+    std::vector<utils::ImagePair> m_pairs;
+    PairPrefetchOptions m_options;
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready;      // a decoded pair was stored
+    std::condition_variable m_slotFree;   // the consumer advanced
+    std::map<std::size_t, LoadedPair> m_done;
+    std::size_t m_nextClaim = 0;
+    std::size_t m_nextDeliver = 0;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_workers;
+};
+
+// Writes images on background threads so encoding and disk writes overlap
+// with scoring.
+//
+// write() queues an image (blocking while queueCapacity writes are
+// pending) and returns immediately; parent directories are created as
+// needed. The image buffer is shared, not copied: do not modify it after
+// queuing. finish() (also run by the destructor) drains the queue and
+// returns the paths that failed to write.
+class AsyncImageWriter
+{
+public:
+    explicit AsyncImageWriter(int workers = 1, std::size_t queueCapacity = 16);
+    ~AsyncImageWriter();
+
+    AsyncImageWriter(const AsyncImageWriter&) = delete;
+    AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+
+    void write(std::filesystem::path path, cv::Mat image);
+
+    std::vector<std::filesystem::path> finish();
+
+private:
+    struct Job
+    {
+        std::filesystem::path path;
+        cv::Mat image;
+    };
+
+    void worker_loop();
+
+    std::size_t m_queueCapacity;
+
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<Job> m_jobs;
+    bool m_closing = false;
+    std::vector<std::filesystem::path> m_failed;
+
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace iqa
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+#include <opencv2/core.hpp>
+
+#include "iqalab/region_blocks.hpp"
+
+namespace iqa {
+namespace regions {
+
+// Block grid with a compile-time power-of-two block size.
+//
+// Same layout as BlockGrid16 / make_block16_grid(), but pixel -> block
+// lookups are shifts and in-block offsets are masks. Use the aliases
+// BlockGrid8T .. BlockGrid64T, or RuntimeBlockGrid when the size is only
+// known at run time; both have the same interface, so kernels can be
+// written once as templates over the grid type (see dispatch_block_grid).
+template <int BlockSize>
+class StaticBlockGrid {
+public:
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0,
+                  "StaticBlockGrid: block size must be a power of two");
+
+    static constexpr int kBlockSize = BlockSize;
+    static constexpr int kShift = std::countr_zero(static_cast<unsigned>(BlockSize));
+    static constexpr int kMask  = BlockSize - 1;
+
+    StaticBlockGrid() = default;
+
+    explicit StaticBlockGrid(const cv::Size& size)
+        : m_size(size)
+        , m_blocksX((size.width  + kMask) >> kShift)
+        , m_blocksY((size.height + kMask) >> kShift)
+    {
+    }
+
+    cv::Size image_size() const { return m_size; }
+    int block_size() const { return kBlockSize; }
+    int blocks_x() const { return m_blocksX; }
+    int blocks_y() const { return m_blocksY; }
+
+    int block_x(int x) const { return x >> kShift; }
+    int block_y(int y) const { return y >> kShift; }
+    int offset_in_block(int v) const { return v & kMask; }
+    int block_origin(int b) const { return b << kShift; }
+
+    int block_index(int x, int y) const { return (y >> kShift) * m_blocksX + (x >> kShift); }
+
+    cv::Rect block_rect(int bx, int by) const
+    {
+        const int x0 = bx << kShift;
+        const int y0 = by << kShift;
+        return cv::Rect(x0, y0,
+                        std::min(kBlockSize, m_size.width  - x0),
+                        std::min(kBlockSize, m_size.height - y0));
+    }
+
+    BlockGrid16 to_runtime() const
+    {
+        BlockGrid16 g;
+        g.imageSize = m_size;
+        g.blockSize = kBlockSize;
+        g.blocksX = m_blocksX;
+        g.blocksY = m_blocksY;
+        return g;
+    }
+
+private:
+    cv::Size m_size;
+    int m_blocksX = 0;
+    int m_blocksY = 0;
+};
+
+using BlockGrid8T  = StaticBlockGrid<8>;
+using BlockGrid16T = StaticBlockGrid<16>;
+using BlockGrid32T = StaticBlockGrid<32>;
+using BlockGrid64T = StaticBlockGrid<64>;
+
+// Runtime-size fallback with the StaticBlockGrid interface (divisions).
+class RuntimeBlockGrid {
+public:
+    RuntimeBlockGrid() = default;
+
+    explicit RuntimeBlockGrid(const BlockGrid16& g)
+        : m_grid(g)
+    {
+        CV_Assert(g.blockSize > 0);
+    }
+
+    cv::Size image_size() const { return m_grid.imageSize; }
+    int block_size() const { return m_grid.blockSize; }
+    int blocks_x() const { return m_grid.blocksX; }
+    int blocks_y() const { return m_grid.blocksY; }
+
+    int block_x(int x) const { return x / m_grid.blockSize; }
+    int block_y(int y) const { return y / m_grid.blockSize; }
+    int offset_in_block(int v) const { return v % m_grid.blockSize; }
+    int block_origin(int b) const { return b * m_grid.blockSize; }
+
+    int block_index(int x, int y) const { return block_y(y) * m_grid.blocksX + block_x(x); }
+
+    cv::Rect block_rect(int bx, int by) const
+    {
+        return regions::block_rect(m_grid, by * m_grid.blocksX + bx);
+    }
+
+    BlockGrid16 to_runtime() const { return m_grid; }
+
+private:
+    BlockGrid16 m_grid;
+};
+
+// Part of one pixel row that lies in block column bx: [x0, x1).
+struct BlockRowSegment {
+    int bx = 0;
+    int x0 = 0;
+    int x1 = 0;
+};
+
+// Range over the block segments of a pixel row, left to right.
+//
+//   for (const BlockRowSegment& s : block_row_segments(grid))
+//       for (int x = s.x0; x < s.x1; ++x) ... row[x] belongs to block s.bx
+//
+// Advancing only adds the block size; there is no per-pixel index math.
+template <class Grid>
+class BlockRowSegments {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = BlockRowSegment;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const BlockRowSegment*;
+        using reference         = const BlockRowSegment&;
+
+        iterator() = default;
+        iterator(int bx, int step, int width)
+            : m_step(step)
+            , m_width(width)
+        {
+            m_seg.bx = bx;
+            m_seg.x0 = std::min(bx * step, width);
+            m_seg.x1 = std::min(m_seg.x0 + step, width);
+        }
+
+        reference operator*() const { return m_seg; }
+        pointer operator->() const { return &m_seg; }
+
+        iterator& operator++()
+        {
+            ++m_seg.bx;
+            m_seg.x0 = m_seg.x1;
+            m_seg.x1 = std::min(m_seg.x0 + m_step, m_width);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator& o) const { return m_seg.bx == o.m_seg.bx; }
+        bool operator!=(const iterator& o) const { return m_seg.bx != o.m_seg.bx; }
+
+    private:
+        BlockRowSegment m_seg;
+        int m_step = 0;
+        int m_width = 0;
+    };
+
+    explicit BlockRowSegments(const Grid& grid)
+        : m_step(grid.block_size())
+        , m_width(grid.image_size().width)
+        , m_blocksX(grid.blocks_x())
+    {
+    }
+
+    iterator begin() const { return iterator(0, m_step, m_width); }
+    iterator end() const { return iterator(m_blocksX, m_step, m_width); }
+
+private:
+    int m_step;
+    int m_width;
+    int m_blocksX;
+};
+
+template <class Grid>
+BlockRowSegments<Grid> block_row_segments(const Grid& grid)
+{
+    return BlockRowSegments<Grid>(grid);
+}
+
+// Pixel rows [y0, y1) of block row by.
+template <class Grid>
+cv::Range block_row_span(const Grid& grid, int by)
+{
+    const int y0 = grid.block_origin(by);
+    return cv::Range(y0, std::min(y0 + grid.block_size(), grid.image_size().height));
+}
+
+// Call fn(grid) with a StaticBlockGrid for 8/16/32/64 and with a
+// RuntimeBlockGrid for any other block size.
+template <class Fn>
+decltype(auto) dispatch_block_grid(const BlockGrid16& g, Fn&& fn)
+{
+    switch (g.blockSize) {
+    case 8:  return fn(BlockGrid8T(g.imageSize));
+    case 16: return fn(BlockGrid16T(g.imageSize));
+    case 32: return fn(BlockGrid32T(g.imageSize));
+    case 64: return fn(BlockGrid64T(g.imageSize));
+    default: return fn(RuntimeBlockGrid(g));
+    }
+}
+
+} // namespace regions
+} // namespace iqa
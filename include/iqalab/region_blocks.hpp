@@ -22,6 +22,15 @@ struct BlockRegionMasks {
     cv::Mat1b detail;  // 255 where block is classified as detail
 };
 
+// Class assigned to a block. Flat/Mid/Detail use the same values as
+// RegionClass, so a class grid reads like a coarse region label map.
+enum class BlockClass : uchar {
+    Flat   = 0,
+    Mid    = 1,
+    Detail = 2,
+    None   = 255  // unclassified (no dominant class)
+};
+
 // Build block-level masks from pixel-level flat/mid/detail masks.
 //
 // For each 16x16 block:
@@ -47,11 +56,31 @@ BlockRegionMasks make_block_region_masks_from_pixel_masks(
     double strongPairFrac  = 0.3
 );
 
+// Classify every block of the grid from a pixel label map
+// (RegionMasks::labels: 0=flat, 1=mid, 2=detail) in one row-streaming pass.
+//
+// Returns a compact blocksY x blocksX grid of BlockClass values; the
+// decision rule (majority with minDominantFrac, flat+detail -> mid special
+// case with strongPairFrac) is the same as in
+// make_block_region_masks_from_pixel_masks().
+cv::Mat1b classify_blocks_from_labels(
+    const BlockGrid16& grid,
+    const cv::Mat1b& labels,
+    double minDominantFrac = 0.5,
+    double strongPairFrac  = 0.3
+);
+
+// Expand a class grid (see classify_blocks_from_labels) to full-size block
+// masks. Only needed when a consumer really wants pixel masks.
+BlockRegionMasks expand_block_classes(const BlockGrid16& grid,
+                                      const cv::Mat1b& classes);
+
 // Initialize a regular block grid for given image size.
 BlockGrid16 make_block16_grid(const cv::Size& size, int blockSize = 16);
 
 // Get block index for pixel (x,y).
-// For blockSize == 16 you can later replace division by shift (x >> 4, y >> 4).
+// Runtime-size version; for 8/16/32/64 hot loops use the shift-based
+// StaticBlockGrid from region_block_grid.hpp.
 int block_index(const BlockGrid16& g, int x, int y);
 
 // Get rectangle (ROI) for given block index.
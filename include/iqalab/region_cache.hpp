@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <opencv2/core/mat.hpp>
+
+#include "iqalab/region_provider.hpp"
+
+namespace iqa
+{
+
+// RegionProvider decorator that caches segmentations across runs.
+//
+// The key is a content hash of the reference pixels (type, size, data)
+// combined with the inner provider's name() and parameters(). Lookups go
+//   1) to an in-process LRU of the last `memoryEntries` results,
+//   2) to `cacheDir/<key>.iqrm`, memory-mapped and copied out,
+//   3) to the inner provider; the result is then written to disk and the LRU.
+//
+// A cache file holds a small header, the CV_8U label map and, when the
+// inner provider produced it, the CV_32F gradMag plane. Files are written
+// to a temporary name and renamed, so concurrent runs sharing a directory
+// never see partial files; write failures only skip persisting.
+//
+// Returned masks share pixel buffers with the LRU: clone them before
+// modifying. compute_regions() may be called from several threads.
+class CachedRegionProvider final : public RegionProvider
+{
+public:
+    struct Stats
+    {
+        std::size_t memoryHits = 0;
+        std::size_t diskHits = 0;
+        std::size_t misses = 0;   // computed by the inner provider
+    };
+
+    CachedRegionProvider(std::shared_ptr<const RegionProvider> inner,
+                         std::filesystem::path cacheDir,
+                         std::size_t memoryEntries = 32);
+
+    RegionMasks compute_regions(const cv::Mat& labRef) const override;
+
+    // Same identity as the wrapped provider: caching does not change results.
+    std::string name() const override { return m_inner->name(); }
+    std::string parameters() const override { return m_inner->parameters(); }
+
+    Stats stats() const;
+
+    const std::filesystem::path& cache_dir() const { return m_cacheDir; }
+
+    // Cache key of labRef for this provider (also the file stem, in hex).
+    std::uint64_t cache_key(const cv::Mat& labRef) const;
+
+private:
+    bool lookup_memory(std::uint64_t key, RegionMasks& out) const;
+    void insert_memory(std::uint64_t key, const RegionMasks& masks) const;
+
+    bool load_file(std::uint64_t key, const cv::Size& size, RegionMasks& out) const;
+    void store_file(std::uint64_t key, const RegionMasks& masks) const;
+
+    std::filesystem::path file_path(std::uint64_t key) const;
+
+    std::shared_ptr<const RegionProvider> m_inner;
+    std::filesystem::path m_cacheDir;
+    std::size_t m_memoryEntries;
+    std::uint64_t m_providerSeed;
+
+    using LruList = std::list<std::pair<std::uint64_t, RegionMasks>>;
+
+    mutable std::mutex m_mutex;
+    mutable LruList m_lru;   // most recently used first
+    mutable std::unordered_map<std::uint64_t, LruList::iterator> m_lruIndex;
+    mutable Stats m_stats;
+};
+
+} // namespace iqa
@@ -1,14 +1,51 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include <opencv2/core.hpp>
+
+#include "iqalab/utils/mask_spans.hpp"
+
 namespace iqa {
 
+// Region class of a pixel, as stored in RegionMasks::labels.
+enum class RegionClass : uchar {
+  Flat   = 0,
+  Mid    = 1,
+  Detail = 2
+};
+
+constexpr int kRegionClassCount = 3;
+
+// Flat/mid/detail segmentation stored as a single-plane label map.
+//
+// The classes are mutually exclusive, so one CV_8U plane replaces three
+// 0/255 masks. Mask views are materialized only when a caller asks for them.
 struct RegionMasks {
-  cv::Mat flat;    // CV_8U, 255 = flat
-  cv::Mat detail;  // CV_8U, 255 = detail
-  cv::Mat mid;     // CV_8U, 255 = pośrednie
+  cv::Mat labels;      // CV_8U, RegionClass per pixel (0=flat, 1=mid, 2=detail)
   cv::Mat gradMag;     // CV_32F, |grad| refL
+
+  // 0/255 CV_8U mask of one class (allocated on each call).
+  cv::Mat mask(RegionClass c) const;
+
+  cv::Mat flat() const   { return mask(RegionClass::Flat); }
+  cv::Mat mid() const    { return mask(RegionClass::Mid); }
+  cv::Mat detail() const { return mask(RegionClass::Detail); }
 };
 
+// Per-class pixel counts of a label map (one pass).
+std::array<std::size_t, kRegionClassCount> count_region_labels(const cv::Mat& labels);
+
+// Agreement between two label maps of the same size (e.g. an approximate
+// segmentation against the full-resolution one).
+struct RegionLabelAgreement {
+  double agreement = 0.0;                                  // fraction of pixels with equal labels
+  std::array<double, kRegionClassCount> iou{};             // per-class intersection over union
+  std::array<std::array<std::size_t, kRegionClassCount>,
+             kRegionClassCount> confusion{};               // [label in a][label in b] pixel counts
+};
+
+RegionLabelAgreement compare_region_labels(const cv::Mat& a, const cv::Mat& b);
+
 RegionMasks compute_region_masks(const cv::Mat& img,
                                float flatPercentile   = 0.3f,
                                float detailPercentile = 0.7f);
@@ -28,6 +65,12 @@ ImpulseScore score_impulses(const cv::Mat& refL,
                             const cv::Mat& distL,
                             const RegionMasks& masks);
 
+// Same statistics over an arbitrary (typically sparse) span-indexed mask;
+// only pixels inside the spans are visited.
+ImpulseScore score_impulses(const cv::Mat& refL,
+                            const cv::Mat& distL,
+                            const MaskSpans& spans);
+
 struct BlurScore {
   double meanLossOnDetail;  // average gradient loss per detail (magRef - magDist, >0)
   double p95LossOnDetail;   // 95th percentile of gradient loss
@@ -5,6 +5,7 @@
 
 #include <opencv2/core/mat.hpp>
 
+#include "iqalab/region_blocks.hpp"
 #include "iqalab/region_masks.hpp"
 
 namespace iqa
@@ -12,8 +13,8 @@ namespace iqa
 
 // Abstract interface for region segmentation used by IQA feature extractors.
 //
-// Implementations provide flat/mid/detail masks on a reference image
-// in Lab32 (CV_32FC3). Different strategies (pixelwise percentiles,
+// Implementations provide a flat/mid/detail label map (RegionMasks) on a
+// reference image in Lab32 (CV_32FC3). Different strategies (pixelwise percentiles,
 // block-based, superpixels, etc.) can be plugged in behind this interface.
 class RegionProvider
 {
@@ -27,6 +28,11 @@ public:
 
     // Optional identifier for logging / debugging / CSV metadata.
     virtual std::string name() const = 0;
+
+    // Parameters that change the output, as a stable "key=value,..." string.
+    // Together with name() this identifies the segmentation, e.g. for
+    // CachedRegionProvider keys; providers without parameters return "".
+    virtual std::string parameters() const { return std::string(); }
 };
 
 
@@ -48,6 +54,7 @@ public:
     RegionMasks compute_regions(const cv::Mat& labRef) const override;
 
     std::string name() const override { return "pixelwise_percentiles"; }
+    std::string parameters() const override;
 
     float flat_percentile() const   { return m_flatPercentile; }
     float detail_percentile() const { return m_detailPercentile; }
@@ -60,64 +67,135 @@ private:
 
 // Block-based region provider (grid 16x16 or similar).
 //
-// The idea is to classify larger spatial blocks instead of individual pixels,
-// using block-level gradient statistics. This reduces pixel-level noise and
-// naturally aligns with block-based compression artefacts.
+// Classifies regular blocks instead of individual pixels, using block-level
+// gradient statistics. This reduces pixel-level noise and naturally aligns
+// with block-based compression artefacts.
 //
-// For now this is a placeholder; compute_regions() throws, and will be
-// implemented once the grid-based scheme is finalized.
+// |grad L|^2 (Sobel 3x3) is summed through an integral image, so the mean
+// gradient energy of any block costs O(1) regardless of blockSize. Blocks
+// are then thresholded at flatPercentile / detailPercentile of the
+// block-energy distribution, and every pixel takes the class of its block.
+// The block layout is regions::make_block16_grid(size, blockSize).
 class BlockRegionProvider final : public RegionProvider
 {
 public:
     // blockSize: width/height of the grid blocks in pixels (e.g. 16).
-    explicit BlockRegionProvider(int blockSize = 16);
+    explicit BlockRegionProvider(int blockSize          = 16,
+                                 float flatPercentile   = 0.3f,
+                                 float detailPercentile = 0.7f);
 
     RegionMasks compute_regions(const cv::Mat& labRef) const override;
 
+    // Block classes only: blocksY x blocksX grid of regions::BlockClass
+    // (never None). gradMag, if not null, receives the pixel gradient
+    // magnitude used for RegionMasks::gradMag.
+    cv::Mat1b compute_block_classes(const cv::Mat& labRef,
+                                    regions::BlockGrid16& grid,
+                                    cv::Mat* gradMag = nullptr) const;
+
     std::string name() const override { return "block_grid"; }
+    std::string parameters() const override;
 
     int block_size() const { return m_blockSize; }
+    float flat_percentile() const   { return m_flatPercentile; }
+    float detail_percentile() const { return m_detailPercentile; }
 
 private:
-    int m_blockSize;
+    int   m_blockSize;
+    float m_flatPercentile;
+    float m_detailPercentile;
 };
 
 
-// Superpixel-based region provider (e.g. SLIC in Lab space).
-//
-// The reference image is segmented into superpixels, then each superpixel
-// is classified into flat/mid/detail based on region-level gradient/texture
-// statistics. This is expected to be the most perceptually meaningful scheme
-// but also the heaviest.
+// Superpixel-based region provider (SLIC in Lab space).
 //
-// For now this is a placeholder; compute_regions() throws, and will be
-// implemented once the SLIC-based pipeline is in place.
+// The reference image is segmented into superpixels (regions::
+// slic_superpixels), then each superpixel is classified into
+// flat/mid/detail by its mean gradient magnitude, thresholded at
+// pixel-weighted flatPercentile / detailPercentile. This is expected to be
+// the most perceptually meaningful scheme but also the heaviest; SLIC runs
+// multithreaded with a vectorized distance kernel.
 class SuperpixelRegionProvider final : public RegionProvider
 {
 public:
     // desiredSuperpixels: target number of superpixels per image.
     // compactness: SLIC compactness parameter (color vs spatial balance).
     SuperpixelRegionProvider(int desiredSuperpixels = 800,
-                             float compactness      = 10.0f);
+                             float compactness      = 10.0f,
+                             float flatPercentile   = 0.3f,
+                             float detailPercentile = 0.7f);
 
     RegionMasks compute_regions(const cv::Mat& labRef) const override;
 
     std::string name() const override { return "superpixel"; }
+    std::string parameters() const override;
 
     int   desired_superpixels() const { return m_desiredSuperpixels; }
     float compactness() const         { return m_compactness; }
+    float flat_percentile() const     { return m_flatPercentile; }
+    float detail_percentile() const   { return m_detailPercentile; }
 
 private:
     int   m_desiredSuperpixels;
     float m_compactness;
+    float m_flatPercentile;
+    float m_detailPercentile;
+};
+
+
+// Pixelwise percentile segmentation computed on a downscaled pyramid level,
+// for very large images.
+//
+// Lab is reduced by `downscale` (typically 2 or 4, INTER_AREA), gradients and percentile thresholds
+// are computed there, and labels are upsampled to full resolution. Only
+// low-res pixels within refineRadius of a class boundary are revisited at
+// full resolution: their gradient magnitude is recomputed exactly (same
+// operator as compute_region_masks32) tile by tile and classified with
+// full-resolution thresholds estimated from a regular sample of pixels.
+// No full-resolution gradient planes are allocated and nothing of full
+// size is sorted.
+//
+// RegionMasks::gradMag is the upsampled low-res magnitude (rescaled to
+// full-res units), exact in refined pixels.
+class MultiResolutionRegionProvider final : public RegionProvider
+{
+public:
+    // downscale: reduction factor per axis (>= 2; typically 2 or 4).
+    // refineRadius: width (in low-res pixels) of the band around class
+    //   boundaries that is refined at full resolution; 0 disables refinement.
+    explicit MultiResolutionRegionProvider(int downscale          = 2,
+                                           float flatPercentile   = 0.3f,
+                                           float detailPercentile = 0.7f,
+                                           int refineRadius       = 1);
+
+    RegionMasks compute_regions(const cv::Mat& labRef) const override;
+
+    std::string name() const override { return "multires_percentiles"; }
+    std::string parameters() const override;
+
+    // Compare this provider's labels with full-resolution
+    // compute_region_masks32() at the same percentiles. Runs both, so it is
+    // meant for validation, not for production passes.
+    RegionLabelAgreement agreement_with_full_resolution(const cv::Mat& labRef) const;
+
+    int   downscale() const         { return m_downscale; }
+    int   refine_radius() const     { return m_refineRadius; }
+    float flat_percentile() const   { return m_flatPercentile; }
+    float detail_percentile() const { return m_detailPercentile; }
+
+private:
+    int   m_downscale;
+    float m_flatPercentile;
+    float m_detailPercentile;
+    int   m_refineRadius;
 };
 
 
 // Convenience factory for the default provider used in examples and tools.
 //
 // Currently this returns a PixelwiseRegionProvider with standard percentiles,
-// but it can be switched later to block- or superpixel-based segmentation
-// without changing caller code.
+// but it can be switched to BlockRegionProvider (much cheaper on large
+// images) or superpixel-based segmentation without changing caller code.
 std::unique_ptr<RegionProvider> make_default_region_provider();
 
 } // namespace iqa
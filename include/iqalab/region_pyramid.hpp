@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "iqalab/region_blocks.hpp"
+
+namespace iqa {
+namespace regions {
+
+// Number of pyramid levels and block size of the finest level:
+// level k has blocks of kPyramidBaseBlock << k pixels (8, 16, 32, 64),
+// i.e. the JPEG / HEVC CTU / AV1 superblock partition sizes.
+constexpr int kPyramidLevels    = 4;
+constexpr int kPyramidBaseBlock = 8;
+
+// Accumulated statistics of one block (sums, so they add up bottom-up).
+struct BlockStats {
+    double gradEnergy = 0.0;  // sum of |grad L_ref|^2 (Sobel 3x3)
+    cv::Vec3d diffSq;         // per-channel sum of (ref - dist)^2, zero without dist
+    int area = 0;             // pixels in the block (smaller on right/bottom edges)
+
+    void merge(const BlockStats& o)
+    {
+        gradEnergy += o.gradEnergy;
+        diffSq += o.diffSq;
+        area += o.area;
+    }
+
+    double mean_grad_energy() const { return area > 0 ? gradEnergy / area : 0.0; }
+    cv::Vec3d mse() const { return area > 0 ? diffSq * (1.0 / area) : cv::Vec3d(); }
+};
+
+// Statistics of one level: a regular grid and its blocks, row-major.
+struct BlockStatsLevel {
+    BlockGrid16 grid;
+    std::vector<BlockStats> stats;  // blocksY * blocksX
+
+    const BlockStats& at(int bx, int by) const
+    {
+        return stats[static_cast<std::size_t>(by) * grid.blocksX + bx];
+    }
+};
+
+// Hierarchical block statistics, finest level first.
+//
+// Block (bx, by) of level k covers blocks (2bx..2bx+1, 2by..2by+1) of
+// level k-1 (those that exist on the right/bottom edges).
+struct BlockStatsPyramid {
+    cv::Size imageSize;
+    std::array<BlockStatsLevel, kPyramidLevels> levels;
+
+    // Level whose block size is blockSize (8, 16, 32 or 64).
+    const BlockStatsLevel& level_for_block_size(int blockSize) const;
+};
+
+// Build the pyramid in one pass over the image.
+//
+// labRef / labDist: Lab32 images (CV_32FC3); labDist may be empty, then
+// diffSq stays zero. Only the 8x8 level touches pixels (parallel over block
+// rows); 16/32/64 are summed from their four children, which adds about 1/3
+// of the 8x8 block count, so all grid sizes cost about as much as the
+// finest one alone.
+BlockStatsPyramid build_block_stats_pyramid(const cv::Mat& labRef,
+                                            const cv::Mat& labDist = cv::Mat());
+
+// Leaf of the quadtree partition.
+struct QuadtreeLeaf {
+    int level = 0;    // pyramid level (block size kPyramidBaseBlock << level)
+    int bx = 0;       // block coordinates on that level
+    int by = 0;
+    BlockClass cls = BlockClass::None;
+};
+
+struct QuadtreeClassification {
+    cv::Mat1b classes;                 // 8x8-level grid of BlockClass (never None)
+    std::vector<QuadtreeLeaf> leaves;  // top-level blocks first, children in z-order
+};
+
+// Quadtree flat/mid/detail classification on top of the pyramid.
+//
+// 8x8 blocks are classified by mean gradient energy against the
+// flatPercentile / detailPercentile of the 8x8 distribution (as
+// BlockRegionProvider does for its single grid). Going up, a block stays
+// unsplit when its dominant class covers at least minUniformFrac of its
+// area (1.0 = all children agree) and all of its children are unsplit;
+// every 8x8 block under an unsplit leaf takes the leaf class.
+QuadtreeClassification classify_quadtree(const BlockStatsPyramid& pyramid,
+                                         float flatPercentile   = 0.3f,
+                                         float detailPercentile = 0.7f,
+                                         double minUniformFrac  = 1.0);
+
+} // namespace regions
+} // namespace iqa
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "iqalab/utils/file_grouping.hpp"
+
+namespace iqa
+{
+
+// Reduced-resolution triage before full analysis.
+//
+// Both images are decoded at 1/reduction scale (cv::IMREAD_REDUCED_COLOR_*);
+// for JPEG, libjpeg scales the inverse DCT, so decoding itself gets much
+// cheaper, other formats are decoded fully and downsampled. Cheap proxies
+// are computed on the small images and a pair is promoted to full analysis
+// when any of them reaches its threshold. Set a threshold to +infinity to
+// disable that proxy.
+//
+// The proxies are not the full-resolution metrics: downsampling averages
+// out noise and fine blur, so thresholds should be tuned per reduction.
+struct ScreeningOptions
+{
+    int reduction = 4;                // 1, 2, 4 or 8
+    double mseThreshold = 2.0;        // global BGR MSE (mse::compute_mse)
+    double blurThreshold = 0.05;      // blur::relative_blur_L on Lab32
+    double blockingThreshold = 0.05;  // blocking_score of dist, 8/reduction grid
+};
+
+struct ScreeningResult
+{
+    bool readable = false;       // both reduced images decoded
+    bool sizeMismatch = false;   // decoded, but sizes differ by more than 1 px
+    double mse = 0.0;
+    double blurL = 0.0;
+    double blocking = 0.0;   // 0 when the scaled grid is below 2 px (reduction 8)
+    // Unreadable and mismatched pairs are always promoted, so the full
+    // analysis reports them.
+    bool promoted = true;
+};
+
+// BGR (CV_8UC3) decode at 1/reduction of the full size; empty if the file
+// cannot be read.
+cv::Mat read_image_reduced(const std::filesystem::path& path, int reduction);
+
+// Proxies and promotion for one pair of reduced images. Sizes may differ by
+// one pixel (JPEG rounds scaled sizes up, other codecs down); both are then
+// cropped to the common size.
+ScreeningResult screen_reduced_pair(const cv::Mat& refReduced,
+                                    const cv::Mat& distReduced,
+                                    const ScreeningOptions& options);
+
+// Screen all pairs in parallel (cv::parallel_for_). A reference shared by
+// consecutive pairs is decoded once per chunk of them. Results are in the
+// order of `pairs`.
+std::vector<ScreeningResult> screen_pairs(const std::vector<utils::ImagePair>& pairs,
+                                          const ScreeningOptions& options);
+
+} // namespace iqa
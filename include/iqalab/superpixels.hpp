@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace iqa {
+namespace regions {
+
+// Result of SLIC superpixel segmentation.
+struct SuperpixelSegmentation {
+    cv::Mat labels;                   // CV_32S, superpixel index per pixel
+    int count = 0;                    // number of superpixels (labels are 0..count-1)
+    std::vector<int> area;            // pixels per superpixel
+    std::vector<double> meanGradient; // mean of gradMag per superpixel (empty if no gradMag given)
+};
+
+// SLIC superpixels (Achanta et al.) in Lab space.
+//
+// labRef:
+//   - Lab32 image (CV_32FC3).
+// desiredSuperpixels:
+//   - target number of superpixels; seeds are placed on a regular grid
+//     with spacing S = sqrt(N / desiredSuperpixels).
+// compactness:
+//   - SLIC m: weight of spatial distance vs Lab distance
+//     (D^2 = dLab^2 + (dxy / S)^2 * m^2).
+// gradMag:
+//   - optional CV_32F plane; if given, its per-superpixel mean is gathered
+//     in the final assignment pass (no extra pass over the image).
+//
+// Assignment is pixel-centric and runs in parallel over fixed row bands:
+// each row tests only clusters whose center lies within S rows, over their
+// 2S+1 column window, with a branch-free (auto-vectorizable) distance
+// kernel on planar L/a/b rows. Center updates use per-band partial sums
+// reduced in band order, so results do not depend on the thread count.
+// Connectivity is not enforced; a superpixel may consist of several pieces.
+SuperpixelSegmentation slic_superpixels(const cv::Mat& labRef,
+                                        int desiredSuperpixels,
+                                        float compactness,
+                                        const cv::Mat& gradMag = cv::Mat(),
+                                        int iterations = 10);
+
+} // namespace regions
+} // namespace iqa
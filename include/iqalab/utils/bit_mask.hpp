@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace iqa {
+
+// Bit-packed binary mask: 1 bit per pixel, 64-bit words, row-major.
+//
+// Each row starts on a word boundary (words_per_row() = ceil(cols / 64));
+// bit x of a row lives in word x / 64 at bit position x % 64. Padding bits
+// past `cols` in the last word of a row are always zero, so word-level
+// operations and popcounts never see garbage.
+//
+// Compared with a CV_8U 0/255 mask this is 8x smaller and allows counting,
+// logical ops and reductions to skip 64 empty pixels per zero word.
+class BitMask
+{
+public:
+    BitMask() = default;
+
+    // All-zero mask of the given size.
+    BitMask(int rows, int cols);
+
+    // Pack a CV_8U mask: bit is set where mask(y,x) >= threshold.
+    static BitMask from_mat(const cv::Mat& mask, uchar threshold = 1);
+
+    // Pack a CV_8U label image: bit is set where labels(y,x) == label.
+    static BitMask from_label(const cv::Mat& labels, uchar label);
+
+    // Pack one row of `cols()` CV_8U values (bit set where >= threshold).
+    void assign_row(int y, const uchar* values, uchar threshold = 1);
+
+    // Unpack to a CV_8U mask with values 0/255.
+    cv::Mat to_mat() const;
+
+    int rows() const          { return m_rows; }
+    int cols() const          { return m_cols; }
+    int words_per_row() const { return m_wordsPerRow; }
+    bool empty() const        { return m_rows == 0 || m_cols == 0; }
+    cv::Size size() const     { return cv::Size(m_cols, m_rows); }
+
+    const std::uint64_t* row(int y) const { return m_words.data() + static_cast<std::size_t>(y) * m_wordsPerRow; }
+    std::uint64_t* row(int y)             { return m_words.data() + static_cast<std::size_t>(y) * m_wordsPerRow; }
+
+    bool test(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1u; }
+    void set(int x, int y)        { row(y)[x >> 6] |= std::uint64_t(1) << (x & 63); }
+
+    // Number of set bits (popcount over all words).
+    std::size_t count() const;
+
+    // Word-level logical ops; both masks must have the same size.
+    BitMask& operator&=(const BitMask& other);
+    BitMask& operator|=(const BitMask& other);
+
+    // Dilation with a (2r+1)x(2r+1) square structuring element
+    // (r passes of a 3x3 dilation done on whole words).
+    BitMask dilated(int radius) const;
+
+    // Dilation with a CV_8U structuring element of odd size anchored at its
+    // centre, e.g. from cv::getStructuringElement(MORPH_RECT / MORPH_CROSS /
+    // MORPH_ELLIPSE). Each kernel row must be empty or one run centred on
+    // the anchor column. Same result as cv::dilate with the default border.
+    BitMask dilated(const cv::Mat& kernel) const;
+
+private:
+    // Clear padding bits past m_cols in the last word of every row.
+    void clear_padding();
+
+    // 1x3 dilation of every row into `out` (same size).
+    void dilate_rows_once(BitMask& out) const;
+
+    int m_rows = 0;
+    int m_cols = 0;
+    int m_wordsPerRow = 0;
+    std::vector<std::uint64_t> m_words;
+};
+
+BitMask operator&(BitMask a, const BitMask& b);
+BitMask operator|(BitMask a, const BitMask& b);
+
+// Sum of a CV_32F single-channel image over set bits of the mask.
+// Zero words are skipped, so the cost scales with mask density.
+double masked_sum(const cv::Mat& values, const BitMask& mask);
+
+// Mean of (a - b)^2 over set bits, for CV_32F single-channel a, b.
+// Returns 0 for an empty mask.
+double masked_mean_sq_diff(const cv::Mat& a, const cv::Mat& b, const BitMask& mask);
+
+} // namespace iqa
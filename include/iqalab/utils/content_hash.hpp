@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+namespace iqa {
+namespace utils {
+
+// 64-bit non-cryptographic content hash, used for on-disk cache keys.
+// Stable across runs and platforms of the same endianness.
+std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed = 0);
+
+std::uint64_t hash_string(const std::string& s, std::uint64_t seed = 0);
+
+// Hash of a matrix: type, size and pixel data row by row (row padding of
+// non-continuous matrices is not hashed).
+std::uint64_t hash_mat(const cv::Mat& m, std::uint64_t seed = 0);
+
+// 16-digit lowercase hex form, e.g. for file names.
+std::string hash_to_hex(std::uint64_t h);
+
+} // namespace utils
+} // namespace iqa
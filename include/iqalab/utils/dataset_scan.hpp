@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "iqalab/image_type.hpp"
+
+namespace iqa {
+namespace utils {
+
+// One image file found by scan_dataset().
+struct DatasetEntry {
+    std::filesystem::path relPath;     // relative to the manifest root
+    std::uint64_t size = 0;            // bytes
+    std::int64_t  mtime = 0;           // last_write_time, file clock ticks
+    ImageType     type = ImageType::Unknown;  // from the file signature
+    int           width = 0;           // 0 when not probed / not recognized
+    int           height = 0;
+};
+
+// A scanned directory and its mtime; adding, removing or renaming entries
+// changes it, which is what manifest validation relies on.
+struct DatasetDirectory {
+    std::filesystem::path relPath;     // "" for the root
+    std::int64_t  mtime = 0;
+};
+
+// Recursive listing of the image files under a root.
+struct DatasetManifest {
+    std::filesystem::path root;
+    std::vector<DatasetDirectory> directories;  // sorted by relPath
+    std::vector<DatasetEntry> entries;          // sorted by relPath
+    bool headersProbed = false;                 // scanned with probeHeaders
+
+    std::filesystem::path full_path(const DatasetEntry& e) const { return root / e.relPath; }
+
+    // Full paths of all entries, in manifest order.
+    std::vector<std::filesystem::path> paths() const;
+};
+
+struct DatasetScanOptions {
+    // Read image headers for dimensions (and the real type); otherwise
+    // the type comes from the extension and dimensions stay 0.
+    bool probeHeaders = true;
+
+    // Manifest validation also stats every file (mtime + size), not only
+    // the directories. Catches in-place rewrites; costs one stat per file.
+    bool validateFiles = true;
+};
+
+// Scan `root` recursively. Directories are processed in parallel, one task
+// per directory (breadth-first, level by level); files are recognized by
+// extension (is_image_file). Symlinked directories are not followed.
+DatasetManifest scan_dataset(const std::filesystem::path& root,
+                             const DatasetScanOptions& options = DatasetScanOptions());
+
+// Binary manifest I/O. write_manifest() throws std::runtime_error on I/O
+// errors (the file is written to a per-writer temporary name and renamed);
+// read_manifest() returns false for a missing, foreign or truncated file.
+void write_manifest(const DatasetManifest& manifest, const std::filesystem::path& file);
+bool read_manifest(const std::filesystem::path& file, DatasetManifest& manifest);
+
+// True if no directory (and, with validateFiles, no file) changed its
+// mtime or size since the manifest was written. Checks run in parallel.
+bool manifest_is_current(const DatasetManifest& manifest,
+                         const DatasetScanOptions& options = DatasetScanOptions());
+
+// Use `manifestFile` if it exists, belongs to `root` and is current;
+// otherwise rescan and rewrite it. A manifest that cannot be written
+// (read-only directory, lost rename race) is skipped, not an error.
+DatasetManifest load_or_scan_dataset(const std::filesystem::path& root,
+                                     const std::filesystem::path& manifestFile,
+                                     const DatasetScanOptions& options = DatasetScanOptions());
+
+} // namespace utils
+} // namespace iqa
@@ -10,6 +10,12 @@ namespace utils {
 
 using FileGroups = std::unordered_map<std::string, std::vector<std::filesystem::path>>;
 
+// Reference / distorted file pair processed by the batch tools.
+struct ImagePair {
+    std::filesystem::path refPath;
+    std::filesystem::path distPath;
+};
+
 // Collect all supported image files from directory (non-recursive),
 // sorted lexicographically by path.
 std::vector<std::filesystem::path>
@@ -39,10 +45,26 @@ collect_distorted_files(const std::filesystem::path& distDir);
 // This is suitable for TID-like datasets with naming:
 //   I01.BMP  ->  i01_01_1.bmp, i01_01_2.bmp, ...
 //
+// Distorted stems are sorted once and each reference takes the contiguous
+// range starting at lower_bound(refStemLower), so grouping costs
+// O((R + D) log D) instead of testing every pair.
+//
 FileGroups group_distorted_by_reference(
     const std::vector<std::filesystem::path>& refFiles,
     const std::vector<std::filesystem::path>& distFiles
 );
 
+// Flatten groups into pairs, in refFiles order and group order within a
+// reference. References without a group (or with an empty one) contribute
+// nothing.
+std::vector<ImagePair> pairs_from_groups(
+    const std::vector<std::filesystem::path>& refFiles,
+    const FileGroups& groups
+);
+
+// Read a pairs list: whitespace-separated "<ref_path> <dist_path>" entries.
+// Throws std::runtime_error if the file cannot be opened.
+std::vector<ImagePair> load_pairs_from_file(const std::filesystem::path& listPath);
+
 } // namespace utils
 } // namespace iqa
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace iqa {
+namespace utils {
+
+// Read-only memory mapping of a whole file.
+//
+// On POSIX systems the file is mmap()ed, so pages are loaded on first access
+// and shared with the OS page cache; elsewhere the file is read into a heap
+// buffer. Move-only; the mapping is released in the destructor.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    // Map `path`; throws std::runtime_error if it cannot be opened or mapped.
+    explicit MappedFile(const std::filesystem::path& path);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return m_data; }
+    std::size_t size() const          { return m_size; }
+    bool empty() const                { return m_size == 0; }
+
+private:
+    void release();
+
+    const unsigned char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_mapped = false;  // true: munmap() on release, false: delete[]
+};
+
+} // namespace utils
+} // namespace iqa
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace iqa {
+
+// Horizontal run of set mask pixels in one row: [x0, x1).
+struct MaskSpan {
+    int x0 = 0;
+    int x1 = 0;
+};
+
+// Run-length index of a binary mask, one span list per row.
+//
+// Built once per mask; masked kernels that iterate over spans instead of
+// testing every pixel cost O(mask area + rows) rather than O(image area),
+// which matters for the typical almost-empty impulse / flat-blocking masks.
+struct MaskSpans {
+    cv::Size size;                // size of the source mask
+    std::vector<int> rowStart;    // spans of row y: [rowStart[y], rowStart[y+1])
+    std::vector<MaskSpan> spans;  // all spans, row-major
+    std::size_t area = 0;         // number of set pixels
+
+    bool empty() const { return area == 0; }
+
+    const MaskSpan* row_begin(int y) const { return spans.data() + rowStart[y]; }
+    const MaskSpan* row_end(int y) const   { return spans.data() + rowStart[y + 1]; }
+};
+
+// Build the span index of a CV_8U mask; a pixel is set where mask >= threshold.
+MaskSpans build_mask_spans(const cv::Mat& mask, uchar threshold = 1);
+
+} // namespace iqa
@@ -5,6 +5,8 @@ namespace iqa {
 
 /// Counts pixels where mask(x,y) > threshold.
 /// Useful for impulse masks, flat masks, detail masks, etc.
+/// For repeated counting/combining of the same mask see BitMask
+/// (utils/bit_mask.hpp).
 std::size_t count_nonzero_threshold(const cv::Mat& mask,
                                            uchar threshold = 1);
 
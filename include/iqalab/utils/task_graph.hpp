@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace iqa {
+namespace utils {
+
+class ThreadPool;
+
+// Small static dependency graph of named tasks.
+//
+// Tasks are added in a topological order (dependencies must already be in
+// the graph) and run once per run() call. run(pool) submits every task
+// whose dependencies have finished to the pool and blocks until the graph
+// is done; run() executes the tasks in insertion order on the calling
+// thread. Either way each task's start and duration are recorded, relative
+// to the start of run().
+//
+// If a task throws, tasks that have not started yet are skipped and run()
+// rethrows the first exception once the started ones have finished.
+// run(pool) waits on the graph only, not on the whole pool, so the pool
+// may be shared; it must not be called from a task of the same pool.
+class TaskGraph
+{
+public:
+    using Id = std::size_t;
+    using Fn = std::function<void()>;
+
+    struct Timing
+    {
+        std::string name;
+        double startMs = 0.0;
+        double durationMs = 0.0;
+        bool ran = false;   // false: skipped after an earlier failure
+    };
+
+    Id add(std::string name, Fn fn, std::vector<Id> dependencies = {});
+
+    void run(ThreadPool& pool);
+    void run();
+
+    std::size_t size() const { return m_nodes.size(); }
+
+    // Per task, in insertion order, from the last run.
+    const std::vector<Timing>& timings() const { return m_timings; }
+
+    // Wall time of the last run.
+    double wall_ms() const { return m_wallMs; }
+
+private:
+    struct Node
+    {
+        std::string name;
+        Fn fn;
+        std::vector<Id> dependencies;
+        std::vector<Id> dependents;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Timing> m_timings;
+    double m_wallMs = 0.0;
+};
+
+} // namespace utils
+} // namespace iqa
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace iqa {
+namespace utils {
+
+// Fixed-size thread pool with per-worker task queues and work stealing.
+//
+// submit() from outside the pool spreads tasks round-robin over the worker
+// queues; submit() from a task pushes to the calling worker's own queue. A
+// worker whose queue is empty steals from the others, so long tasks (large
+// images) do not leave the remaining workers idle behind a static split.
+// Owners and thieves both take from the front, so tasks start roughly in
+// submission order.
+//
+// wait_idle() blocks until every submitted task has finished and rethrows
+// the first exception a task threw (later ones are dropped); it must not
+// be called from a task. The destructor finishes all queued tasks before
+// joining.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // Called on each worker thread, with its index, before it runs tasks
+    // (e.g. to pin the thread to a core).
+    using WorkerInit = std::function<void(int)>;
+
+    // threads <= 0: std::thread::hardware_concurrency() (at least 1).
+    explicit ThreadPool(int threads = 0, WorkerInit init = WorkerInit());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(Task task);
+    void wait_idle();
+
+    int size() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(std::size_t id);
+    bool take_task(std::size_t id, Task& task);
+    void run_task(Task& task);
+
+    WorkerInit m_init;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_nextQueue{0};
+
+    // m_queued (tasks in queues) changes only under m_mutex so a worker
+    // cannot miss a wake-up between its check and its wait.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::size_t m_queued = 0;
+    std::size_t m_unfinished = 0;   // submitted, not yet completed
+    bool m_stopping = false;
+    std::exception_ptr m_error;
+};
+
+} // namespace utils
+} // namespace iqa
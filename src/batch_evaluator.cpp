@@ -0,0 +1,181 @@
+#include "iqalab/batch_evaluator.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "iqalab/execution_policy.hpp"
+#include "iqalab/image_type.hpp"
+#include "iqalab/lab_disk_cache.hpp"
+#include "iqalab/pair_metrics.hpp"
+#include "iqalab/utils/thread_pool.hpp"
+
+namespace iqa
+{
+
+namespace
+{
+
+// Output of one pair, handed from a worker to the writer. `ready` is the
+// only synchronization: the worker fills the other fields, then publishes
+// with a release store; the writer acquires before reading them.
+struct ResultSlot
+{
+    std::atomic<bool> ready{false};
+    bool ok = false;
+    std::string text;   // CSV row, or an error line for `log`
+};
+
+// `refInfo` / `distInfo` are the headers probed by the ExecutionPlan.
+void score_pair(const utils::ImagePair& pair, const ImageInfo& refInfo,
+                const ImageInfo& distInfo, ImageCache& refCache,
+                const RegionProvider& regions, const MetricSelection& metrics,
+                ResultSlot& slot)
+{
+    const std::string names = pair.refPath.string() + " vs " + pair.distPath.string();
+
+    if (probed_sizes_differ(refInfo, distInfo)) {
+        slot.text = "Size mismatch: " + names;
+        return;
+    }
+
+    const cv::Mat labRef = refCache.load_lab32(pair.refPath);
+    if (labRef.empty()) {
+        slot.text = "Cannot read image: " + pair.refPath.string();
+        return;
+    }
+    const cv::Mat labDist = read_image_lab32(pair.distPath);
+    if (labDist.empty()) {
+        slot.text = "Cannot read image: " + pair.distPath.string();
+        return;
+    }
+    if (labRef.size() != labDist.size()) {
+        slot.text = "Size mismatch: " + names;
+        return;
+    }
+
+    const PairMetrics values = compute_pair_metrics(labRef, labDist, regions, metrics);
+
+    std::ostringstream row;
+    write_pair_metrics_csv_row(row, pair.refPath, pair.distPath, values, metrics);
+    slot.text = row.str();
+    slot.ok = true;
+}
+
+void publish(ResultSlot& slot, bool ok, std::string text)
+{
+    slot.ok = ok;
+    slot.text = std::move(text);
+    slot.ready.store(true, std::memory_order_release);
+    slot.ready.notify_one();
+}
+
+// Score one pair and publish its slot; never throws, since the writer
+// waits for every slot.
+void score_into_slot(const utils::ImagePair& pair, const ImageInfo& refInfo,
+                     const ImageInfo& distInfo, ImageCache& refCache,
+                     const RegionProvider& regions, const MetricSelection& metrics,
+                     ResultSlot& slot)
+{
+    try {
+        score_pair(pair, refInfo, distInfo, refCache, regions, metrics, slot);
+    } catch (const std::exception& e) {
+        slot.ok = false;
+        slot.text = "Error scoring " + pair.refPath.string() + " vs " +
+                    pair.distPath.string() + ": " + e.what();
+    } catch (...) {
+        slot.ok = false;
+        slot.text = "Error scoring " + pair.refPath.string() + " vs " +
+                    pair.distPath.string();
+    }
+    publish(slot, slot.ok, std::move(slot.text));
+}
+
+} // anonymous namespace
+
+BatchEvaluator::BatchEvaluator(BatchOptions options)
+    : m_options(std::move(options))
+    , m_imageCache(m_options.imageCacheBytes)
+{
+    if (!m_options.regions)
+        m_options.regions = make_default_region_provider();
+    m_imageCache.set_disk_cache(m_options.labCache);
+}
+
+BatchSummary BatchEvaluator::run(const std::vector<utils::ImagePair>& pairs,
+                                 std::ostream& csv,
+                                 std::ostream* log)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    BatchSummary summary;
+    summary.pairs = pairs.size();
+
+    write_pair_metrics_csv_header(csv, m_options.metrics);
+
+    std::unique_ptr<ResultSlot[]> slots(new ResultSlot[pairs.size()]);
+    const RegionProvider& regions = *m_options.regions;
+
+    const ExecutionPolicy policy(m_options.execution);
+    const ExecutionPlan plan = policy.plan(pairs);
+
+    auto score = [&](std::size_t i) {
+        score_into_slot(pairs[i], plan.refInfo[i], plan.distInfo[i], m_imageCache,
+                        regions, m_options.metrics, slots[i]);
+    };
+
+    // Scoring runs on its own thread while this one drains the slots.
+    // cv::setNumThreads() is process-wide, so the two modes run as phases.
+    std::thread scheduler([&] {
+        try {
+            if (plan.withinImagePairs > 0) {
+                const ScopedCvThreads cvThreads(plan.cvThreadsWithin);
+                for (std::size_t i = 0; i < pairs.size(); ++i)
+                    if (plan.modes[i] == ParallelMode::WithinImage)
+                        score(i);
+            }
+
+            const ScopedCvThreads cvThreads(plan.cvThreadsAcross);
+            utils::ThreadPool pool(plan.pairWorkers,
+                                   [&policy](int worker) { policy.on_worker_start(worker); });
+            for (std::size_t i = 0; i < pairs.size(); ++i)
+                if (plan.modes[i] == ParallelMode::AcrossPairs)
+                    pool.submit([&score, i] { score(i); });
+            pool.wait_idle();
+        } catch (const std::exception& e) {
+            // The pool is gone; publish whatever was not scored.
+            for (std::size_t i = 0; i < pairs.size(); ++i) {
+                if (!slots[i].ready.load(std::memory_order_acquire))
+                    publish(slots[i], false, std::string("Batch aborted: ") + e.what());
+            }
+        }
+    });
+
+    // Drain in input order while later pairs are still being scored.
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+        ResultSlot& slot = slots[i];
+        slot.ready.wait(false, std::memory_order_acquire);
+
+        if (slot.ok) {
+            csv << slot.text;
+            ++summary.scored;
+        } else {
+            if (log != nullptr)
+                *log << slot.text << "\n";
+            ++summary.failed;
+        }
+        std::string().swap(slot.text);
+    }
+
+    scheduler.join();
+
+    summary.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+} // namespace iqa
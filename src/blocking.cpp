@@ -124,9 +124,15 @@ double blocking_score_channel(const cv::Mat& ch32f,
 }
 
 double blocking_score(const cv::Mat& bgr)
+{
+    return blocking_score(bgr, 8);
+}
+
+double blocking_score(const cv::Mat& bgr, int blockSize)
 {
     CV_Assert(!bgr.empty());
     CV_Assert(bgr.channels() == 3);
+    CV_Assert(blockSize >= 2);
 
     cv::Mat ycrcb;
     cv::cvtColor(bgr, ycrcb, cv::COLOR_BGR2YCrCb);
@@ -168,8 +174,6 @@ double blocking_score(const cv::Mat& bgr)
     if (wY == 0.0 && wCr == 0.0 && wCb == 0.0)
         return 0.0;
 
-    const int blockSize = 8;
-
     // mask of flat regions Y
     cv::Mat flatMask = make_flat_mask(y32f, 2.0f);
 
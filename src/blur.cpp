@@ -3,16 +3,15 @@
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace iqa::blur
 {
 
-// Helper: mean squared gradient magnitude for L channel in Lab (CV_32FC3).
-// If mask is provided (CV_8U, 0/255), the mean is taken only over masked pixels.
-double l_channel_gradient_energy(const cv::Mat& lab,
-                                        const cv::Mat& mask)
+cv::Mat l_gradient_energy_map(const cv::Mat& lab)
 {
     CV_Assert(lab.type() == CV_32FC3);
-    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == lab.size()));
 
     cv::Mat lCh;
     cv::extractChannel(lab, lCh, 0);
@@ -26,17 +25,23 @@ double l_channel_gradient_energy(const cv::Mat& lab,
     cv::Sobel(lBlur, gx, CV_32F, 1, 0, 3, 1.0, 0.0, cv::BORDER_REPLICATE);
     cv::Sobel(lBlur, gy, CV_32F, 0, 1, 3, 1.0, 0.0, cv::BORDER_REPLICATE);
 
-    cv::Mat gx2, gy2, g2;
+    cv::Mat gx2, gy2;
     cv::multiply(gx, gx, gx2);
     cv::multiply(gy, gy, gy2);
-    g2 = gx2 + gy2;
+    return gx2 + gy2;
+}
+
+double mean_gradient_energy(const cv::Mat& energy, const cv::Mat& mask)
+{
+    CV_Assert(energy.type() == CV_32F);
+    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == energy.size()));
 
     if (!mask.empty())
     {
         cv::Mat maskFloat;
         mask.convertTo(maskFloat, CV_32F, 1.0 / 255.0);
 
-        cv::Scalar sumG2 = cv::sum(g2.mul(maskFloat));
+        cv::Scalar sumG2 = cv::sum(energy.mul(maskFloat));
         double sumMask = cv::sum(maskFloat)[0];
 
         if (sumMask <= 0.0)
@@ -46,11 +51,30 @@ double l_channel_gradient_energy(const cv::Mat& lab,
     }
     else
     {
-        cv::Scalar meanG2 = cv::mean(g2);
+        cv::Scalar meanG2 = cv::mean(energy);
         return static_cast<double>(meanG2[0]);
     }
 }
 
+double mean_gradient_energy(const cv::Mat& energy, const BitMask& mask)
+{
+    CV_Assert(energy.type() == CV_32F && energy.size() == mask.size());
+
+    const std::size_t n = mask.count();
+    if (n == 0)
+        return 0.0;
+    return masked_sum(energy, mask) / static_cast<double>(n);
+}
+
+// Helper: mean squared gradient magnitude for L channel in Lab (CV_32FC3).
+// If mask is provided (CV_8U, 0/255), the mean is taken only over masked pixels.
+double l_channel_gradient_energy(const cv::Mat& lab,
+                                        const cv::Mat& mask)
+{
+    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == lab.size()));
+    return mean_gradient_energy(l_gradient_energy_map(lab), mask);
+}
+
 // Relative blur in L channel.
 double relative_blur_L(const cv::Mat& labRef,
                        const cv::Mat& labDist,
@@ -77,13 +101,9 @@ double relative_blur_L(const cv::Mat& labRef,
     return d;
 }
 
-// Helper: mean squared gradient magnitude for a+b channels in Lab (CV_32FC3).
-// If mask is provided (CV_8U, 0/255), the mean is taken only over masked pixels.
-double ab_channels_gradient_energy(const cv::Mat& lab,
-                                          const cv::Mat& mask)
+cv::Mat ab_gradient_energy_map(const cv::Mat& lab)
 {
     CV_Assert(lab.type() == CV_32FC3);
-    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == lab.size()));
 
     cv::Mat aCh, bCh;
     cv::extractChannel(lab, aCh, 1);
@@ -99,32 +119,22 @@ double ab_channels_gradient_energy(const cv::Mat& lab,
     cv::Sobel(bBlur, bgx, CV_32F, 1, 0, 3, 1.0, 0.0, cv::BORDER_REPLICATE);
     cv::Sobel(bBlur, bgy, CV_32F, 0, 1, 3, 1.0, 0.0, cv::BORDER_REPLICATE);
 
-    cv::Mat agx2, agy2, bgx2, bgy2, g2;
+    cv::Mat agx2, agy2, bgx2, bgy2;
     cv::multiply(agx, agx, agx2);
     cv::multiply(agy, agy, agy2);
     cv::multiply(bgx, bgx, bgx2);
     cv::multiply(bgy, bgy, bgy2);
 
-    g2 = agx2 + agy2 + bgx2 + bgy2;
-
-    if (!mask.empty())
-    {
-        cv::Mat maskFloat;
-        mask.convertTo(maskFloat, CV_32F, 1.0 / 255.0);
-
-        cv::Scalar sumG2 = cv::sum(g2.mul(maskFloat));
-        double sumMask = cv::sum(maskFloat)[0];
-
-        if (sumMask <= 0.0)
-            return 0.0;
+    return agx2 + agy2 + bgx2 + bgy2;
+}
 
-        return static_cast<double>(sumG2[0] / sumMask);
-    }
-    else
-    {
-        cv::Scalar meanG2 = cv::mean(g2);
-        return static_cast<double>(meanG2[0]);
-    }
+// Helper: mean squared gradient magnitude for a+b channels in Lab (CV_32FC3).
+// If mask is provided (CV_8U, 0/255), the mean is taken only over masked pixels.
+double ab_channels_gradient_energy(const cv::Mat& lab,
+                                          const cv::Mat& mask)
+{
+    CV_Assert(mask.empty() || (mask.type() == CV_8U && mask.size() == lab.size()));
+    return mean_gradient_energy(ab_gradient_energy_map(lab), mask);
 }
 
 // Relative blur in a+b (chroma) channel pair.
@@ -205,4 +215,146 @@ double relative_sharp_ab(const cv::Mat& labRef,
     return s;
 }
 
+// Helper: mean squared gradient magnitude over the pixels of `spans`,
+// summed over `nChannels` consecutive channels of a Lab32 image starting at
+// `channel0`. Reproduces GaussianBlur(3x3, sigma 1) + Sobel(3x3) with
+// BORDER_REPLICATE, but evaluates them only where the mask is set.
+static double span_gradient_energy(const cv::Mat& lab,
+                                   const MaskSpans& spans,
+                                   int channel0,
+                                   int nChannels)
+{
+    CV_Assert(lab.type() == CV_32FC3);
+    CV_Assert(spans.size == lab.size());
+
+    if (spans.empty())
+        return 0.0;
+
+    cv::Mat gk = cv::getGaussianKernel(3, 1.0, CV_64F);
+    const double g[3] = { gk.at<double>(0), gk.at<double>(1), gk.at<double>(2) };
+
+    const int rows = lab.rows;
+    const int cols = lab.cols;
+
+    auto clampX = [cols](int x) { return std::clamp(x, 0, cols - 1); };
+    auto clampY = [rows](int y) { return std::clamp(y, 0, rows - 1); };
+
+    // Blurred channel value at (x, y), both already clamped to the image.
+    auto blurred = [&](int x, int y, int c) -> double
+    {
+        double v = 0.0;
+        for (int i = -1; i <= 1; ++i)
+        {
+            const float* row = lab.ptr<float>(clampY(y + i));
+            double h = 0.0;
+            for (int j = -1; j <= 1; ++j)
+                h += g[j + 1] * row[3 * clampX(x + j) + c];
+            v += g[i + 1] * h;
+        }
+        return v;
+    };
+
+    // Per-span buffer of blurred values: 3 rows x (span width + 2) columns.
+    std::vector<double> buf;
+    double sumG2 = 0.0;
+
+    for (int y = 0; y < rows; ++y)
+    {
+        for (const MaskSpan* s = spans.row_begin(y); s != spans.row_end(y); ++s)
+        {
+            const int w = s->x1 - s->x0 + 2; // columns x0-1 .. x1
+            buf.resize(static_cast<std::size_t>(3 * w));
+
+            for (int c = channel0; c < channel0 + nChannels; ++c)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    const int by = clampY(y - 1 + k);
+                    for (int j = 0; j < w; ++j)
+                        buf[static_cast<std::size_t>(k * w + j)] =
+                            blurred(clampX(s->x0 - 1 + j), by, c);
+                }
+
+                const double* up   = buf.data();
+                const double* mid  = buf.data() + w;
+                const double* down = buf.data() + 2 * w;
+
+                for (int x = s->x0; x < s->x1; ++x)
+                {
+                    const int j = x - s->x0 + 1;
+                    const double gx = (up[j + 1] - up[j - 1])
+                                    + 2.0 * (mid[j + 1] - mid[j - 1])
+                                    + (down[j + 1] - down[j - 1]);
+                    const double gy = (down[j - 1] + 2.0 * down[j] + down[j + 1])
+                                    - (up[j - 1] + 2.0 * up[j] + up[j + 1]);
+                    sumG2 += gx * gx + gy * gy;
+                }
+            }
+        }
+    }
+
+    return sumG2 / static_cast<double>(spans.area);
+}
+
+// Clamp helpers shared by the span-indexed variants.
+double relative_blur_from_energies(double E_ref, double E_dist, double eps)
+{
+    if (E_ref <= eps)
+        return 0.0;
+    const double d = 1.0 - E_dist / (E_ref + eps);
+    return std::clamp(d, 0.0, 1.5);
+}
+
+double relative_sharp_from_energies(double E_ref, double E_dist, double eps)
+{
+    if (E_ref <= eps)
+        return 0.0;
+    const double s = E_dist / (E_ref + eps) - 1.0;
+    return std::clamp(s, 0.0, 1.5);
+}
+
+double relative_blur_L(const cv::Mat& labRef,
+                       const cv::Mat& labDist,
+                       const MaskSpans& spans,
+                       double eps)
+{
+    CV_Assert(labRef.size() == labDist.size());
+    return relative_blur_from_energies(span_gradient_energy(labRef,  spans, 0, 1),
+                                       span_gradient_energy(labDist, spans, 0, 1),
+                                       eps);
+}
+
+double relative_blur_ab(const cv::Mat& labRef,
+                        const cv::Mat& labDist,
+                        const MaskSpans& spans,
+                        double eps)
+{
+    CV_Assert(labRef.size() == labDist.size());
+    return relative_blur_from_energies(span_gradient_energy(labRef,  spans, 1, 2),
+                                       span_gradient_energy(labDist, spans, 1, 2),
+                                       eps);
+}
+
+double relative_sharp_L(const cv::Mat& labRef,
+                        const cv::Mat& labDist,
+                        const MaskSpans& spans,
+                        double eps)
+{
+    CV_Assert(labRef.size() == labDist.size());
+    return relative_sharp_from_energies(span_gradient_energy(labRef,  spans, 0, 1),
+                                        span_gradient_energy(labDist, spans, 0, 1),
+                                        eps);
+}
+
+double relative_sharp_ab(const cv::Mat& labRef,
+                         const cv::Mat& labDist,
+                         const MaskSpans& spans,
+                         double eps)
+{
+    CV_Assert(labRef.size() == labDist.size());
+    return relative_sharp_from_energies(span_gradient_energy(labRef,  spans, 1, 2),
+                                        span_gradient_energy(labDist, spans, 1, 2),
+                                        eps);
+}
+
 } // namespace iqa::blur
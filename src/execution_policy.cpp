@@ -0,0 +1,121 @@
+#include "iqalab/execution_policy.hpp"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <opencv2/core/utility.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace iqa
+{
+
+ExecutionPolicy::ExecutionPolicy(ExecutionPolicyOptions options)
+    : m_options(options)
+    , m_threads(options.threads)
+{
+    if (m_threads <= 0)
+        m_threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (m_threads <= 0)
+        m_threads = 1;
+}
+
+ExecutionPlan ExecutionPolicy::plan(const std::vector<utils::ImagePair>& pairs) const
+{
+    ExecutionPlan plan;
+    plan.modes.assign(pairs.size(), ParallelMode::AcrossPairs);
+    plan.refInfo.resize(pairs.size());
+    plan.distInfo.resize(pairs.size());
+
+    std::unordered_map<std::string, ImageInfo> refs;
+    for (std::size_t i = 0; i < pairs.size(); ++i) {
+        const std::string refKey = pairs[i].refPath.string();
+        auto it = refs.find(refKey);
+        if (it == refs.end())
+            it = refs.emplace(refKey, probe_image(pairs[i].refPath)).first;
+        plan.refInfo[i] = it->second;
+
+        // Unknown sizes stay AcrossPairs: the decode happens on a worker.
+        const ImageInfo& info = plan.distInfo[i] = probe_image(pairs[i].distPath);
+        if (info.has_size() &&
+            static_cast<std::size_t>(info.width) * static_cast<std::size_t>(info.height) >=
+                m_options.largeImagePixels) {
+            plan.modes[i] = ParallelMode::WithinImage;
+            ++plan.withinImagePairs;
+        }
+    }
+
+    const std::size_t across = pairs.size() - plan.withinImagePairs;
+    const std::size_t threads = static_cast<std::size_t>(m_threads);
+
+    // Enough pairs: one per core, kernels single-threaded. Fewer pairs than
+    // cores: each pair gets an equal share of the cores for its kernels.
+    plan.pairWorkers = static_cast<int>(std::max<std::size_t>(1, std::min(across, threads)));
+    plan.cvThreadsAcross = std::max(1, m_threads / plan.pairWorkers);
+    plan.cvThreadsWithin = m_threads;
+    return plan;
+}
+
+PairGraphPlan ExecutionPolicy::plan_pair_graph(int graphWidth, int otherWorkers) const
+{
+    const int budget = std::max(1, m_threads - std::max(0, otherWorkers));
+
+    PairGraphPlan plan;
+    plan.graphWorkers = std::max(1, std::min(budget, graphWidth));
+    plan.cvThreads = std::max(1, budget / plan.graphWorkers);
+    return plan;
+}
+
+void ExecutionPolicy::on_worker_start(int index) const
+{
+    if (m_options.pinThreads)
+        pin_current_thread(index);
+}
+
+ScopedCvThreads::ScopedCvThreads(int n)
+    : m_previous(cv::getNumThreads())
+{
+    cv::setNumThreads(n);
+}
+
+ScopedCvThreads::~ScopedCvThreads()
+{
+    cv::setNumThreads(m_previous);
+}
+
+bool pin_current_thread(int index)
+{
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return false;
+
+    const int count = CPU_COUNT(&allowed);
+    if (count <= 0 || index < 0)
+        return false;
+
+    int target = index % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        if (target-- == 0) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            return pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0;
+        }
+    }
+    return false;
+#else
+    (void)index;
+    return false;
+#endif
+}
+
+} // namespace iqa
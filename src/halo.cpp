@@ -4,6 +4,7 @@
 #include <cmath>
 #include <vector>
 
+#include <opencv2/core/utility.hpp>
 #include <opencv2/imgproc.hpp>
 
 namespace iqa::halo
@@ -94,29 +95,219 @@ float compute_edge_threshold(const cv::Mat& gradMag,
     return values[idx];
 }
 
-// Helper: sample a value from a single-channel CV_32F image at float coords,
-// using nearest-neighbour (fast and sufficient for halo estimation).
-float sample_nn(const cv::Mat& img, float xf, float yf)
+// Number of quantized edge-normal directions. Must be a power of two.
+constexpr int kNormalDirections = 32;
+
+// Upper bound for HaloParams::profileRadius (profile buffers live on the stack).
+constexpr int kMaxProfileRadius = 8;
+
+// Row band height for parallel edge processing.
+constexpr int kHaloBandRows = 16;
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Precomputed integer sample offsets along quantized edge normals.
+//
+// For direction d (angle 2*pi*d/kNormalDirections) and profile position
+// t in -R..R, the sample lies at (x + dx, y + dy) with
+//   dx = round(t * step * cos(angle)), dy = round(t * step * sin(angle)).
+// This replaces per-sample std::round of the exact normal (nearest-neighbour
+// sampling along a direction quantized to ~11 degrees).
+struct DirectionLut
+{
+    int radius = 0;          // R
+    int length = 0;          // 2R + 1
+    int reach  = 0;          // max |dx|, |dy| over all offsets
+    std::vector<cv::Point> offsets; // [d * length + (t + R)]
+
+    DirectionLut(int profileRadius, double profileStep)
+        : radius(profileRadius)
+        , length(2 * profileRadius + 1)
+        , offsets(static_cast<std::size_t>(kNormalDirections * length))
+    {
+        for (int d = 0; d < kNormalDirections; ++d)
+        {
+            const double angle = 2.0 * kPi * d / kNormalDirections;
+            const double c = std::cos(angle);
+            const double s = std::sin(angle);
+            for (int t = -radius; t <= radius; ++t)
+            {
+                const int dx = static_cast<int>(std::lround(t * profileStep * c));
+                const int dy = static_cast<int>(std::lround(t * profileStep * s));
+                offsets[static_cast<std::size_t>(d * length + t + radius)] = cv::Point(dx, dy);
+                reach = std::max(reach, std::max(std::abs(dx), std::abs(dy)));
+            }
+        }
+    }
+
+    // Offsets into an interleaved 3-channel float image with the given row
+    // stride (in floats), in the same layout as `offsets`.
+    std::vector<std::ptrdiff_t> linear_offsets(std::size_t rowStride) const
+    {
+        std::vector<std::ptrdiff_t> lin(offsets.size());
+        for (std::size_t i = 0; i < offsets.size(); ++i)
+            lin[i] = static_cast<std::ptrdiff_t>(offsets[i].y) * static_cast<std::ptrdiff_t>(rowStride)
+                   + static_cast<std::ptrdiff_t>(offsets[i].x) * 3;
+        return lin;
+    }
+};
+
+// Quantize the direction of (gx, gy) to an index in [0, kNormalDirections).
+inline int quantize_direction(float gx, float gy)
 {
-    int x = static_cast<int>(std::round(xf));
-    int y = static_cast<int>(std::round(yf));
-    if (x < 0 || x >= img.cols || y < 0 || y >= img.rows)
-        return img.at<float>(std::clamp(y, 0, img.rows - 1),
-                             std::clamp(x, 0, img.cols - 1));
-    return img.at<float>(y, x);
+    const double angle = std::atan2(static_cast<double>(gy), static_cast<double>(gx));
+    const int d = static_cast<int>(std::lround(angle * (kNormalDirections / (2.0 * kPi))));
+    return d & (kNormalDirections - 1);
 }
 
-// Helper: check if integer coordinates are inside the image.
-bool in_bounds(const cv::Mat& img, int x, int y)
+// Unit neighbour steps for the 8 half-sectors of 45 degrees, used by
+// non-maximum suppression (sector k covers angles around k * 45 deg).
+constexpr int kNmsDx[8] = { 1, 1, 0, -1, -1, -1,  0,  1 };
+constexpr int kNmsDy[8] = { 0, 1, 1,  1,  0, -1, -1, -1 };
+
+// True if gradMag at (x, y) is a ridge along direction d (a quantized normal
+// index): strictly greater than the neighbour ahead and not smaller than the
+// one behind, so plateaus keep a single pixel. Outside the image counts as 0.
+inline bool is_gradient_ridge(const cv::Mat& gradMag, int x, int y, int d, float g)
 {
-    return x >= 0 && x < img.cols && y >= 0 && y < img.rows;
+    const int k  = ((d + kNormalDirections / 16) / (kNormalDirections / 8)) & 7;
+    const int ax = x + kNmsDx[k], ay = y + kNmsDy[k];
+    const int bx = x - kNmsDx[k], by = y - kNmsDy[k];
+
+    const float ga = (ax >= 0 && ax < gradMag.cols && ay >= 0 && ay < gradMag.rows)
+                         ? gradMag.at<float>(ay, ax) : 0.0f;
+    const float gb = (bx >= 0 && bx < gradMag.cols && by >= 0 && by < gradMag.rows)
+                         ? gradMag.at<float>(by, bx) : 0.0f;
+
+    return g > ga && g >= gb;
+}
+
+// Per-edge profile samples, indexed by t + R.
+struct EdgeProfile
+{
+    float  Lr[2 * kMaxProfileRadius + 1]; // reference L
+    float  dL[2 * kMaxProfileRadius + 1]; // L_dist - L_ref
+    double dC[2 * kMaxProfileRadius + 1]; // |(a,b)_dist - (a,b)_ref|
+};
+
+// Running sums for HaloMetrics aggregation.
+struct HaloAccumulator
+{
+    std::size_t totalEdgePoints = 0;
+    std::size_t haloLPoints     = 0;
+    std::size_t haloAbPoints    = 0;
+    std::size_t profiles        = 0;
+
+    double sumHaloLStrength  = 0.0;
+    double sumHaloLWidth     = 0.0;
+    double sumHaloAbStrength = 0.0;
+    double sumHaloAbWidth    = 0.0;
+
+    void merge(const HaloAccumulator& o)
+    {
+        totalEdgePoints   += o.totalEdgePoints;
+        haloLPoints       += o.haloLPoints;
+        haloAbPoints      += o.haloAbPoints;
+        profiles          += o.profiles;
+        sumHaloLStrength  += o.sumHaloLStrength;
+        sumHaloLWidth     += o.sumHaloLWidth;
+        sumHaloAbStrength += o.sumHaloAbStrength;
+        sumHaloAbWidth    += o.sumHaloAbWidth;
+    }
+};
+
+// Evaluate a single edge profile and add its contribution to acc.
+//
+// All quantities (orientation, overshoot/undershoot, chroma deviation and
+// both halo widths) are computed from the cached samples in one pass; the
+// image is never resampled for the width estimate.
+void accumulate_profile(const EdgeProfile& prof,
+                        int R,
+                        const HaloParams& params,
+                        HaloAccumulator& acc)
+{
+    // Dark/bright side means from the profile extremes (|t| >= 2).
+    double darkSum = 0.0;
+    double brightSum = 0.0;
+    for (int t = 2; t <= R; ++t)
+    {
+        darkSum   += prof.Lr[R - t];
+        brightSum += prof.Lr[R + t];
+    }
+    const int sideCount = R - 1;
+
+    double darkMean   = darkSum   / sideCount;
+    double brightMean = brightSum / sideCount;
+
+    // Ensure orientation: t > 0 goes from dark to bright.
+    const bool flipped = (brightMean < darkMean);
+    if (flipped)
+        std::swap(darkMean, brightMean);
+
+    const double contrastL = brightMean - darkMean;
+    if (contrastL < params.minContrastL)
+        return;
+
+    const double widthThrL = params.haloLThreshold * contrastL;
+
+    double maxOvershootL  = 0.0; // bright side
+    double maxUndershootL = 0.0; // dark side (dist darker than ref)
+    double maxChromaDev   = 0.0; // absolute chroma deviation
+
+    int haloLPixelsWidth  = 0;
+    int haloAbPixelsWidth = 0;
+
+    for (int t = -R; t <= R; ++t)
+    {
+        const int i = flipped ? (R - t) : (R + t);
+        const double dL = static_cast<double>(prof.dL[i]);
+        const double dC = prof.dC[i];
+
+        if (t > 0)
+        {
+            if (dL > maxOvershootL)
+                maxOvershootL = dL;
+        }
+        else if (t < 0)
+        {
+            if (-dL > maxUndershootL)
+                maxUndershootL = -dL;
+        }
+
+        if (dC > maxChromaDev)
+            maxChromaDev = dC;
+
+        if (std::abs(dL) >= widthThrL)
+            ++haloLPixelsWidth;
+        if (dC >= params.haloAbThreshold)
+            ++haloAbPixelsWidth;
+    }
+
+    // L halo strength, relative to contrast.
+    const double denom = contrastL + params.epsHalo;
+    const double haloLPoint = std::max(maxOvershootL, maxUndershootL) / denom;
+
+    if (haloLPoint >= params.haloLThreshold)
+    {
+        ++acc.haloLPoints;
+        acc.sumHaloLStrength += haloLPoint;
+        acc.sumHaloLWidth    += haloLPixelsWidth * params.profileStep;
+    }
+
+    if (maxChromaDev >= params.haloAbThreshold)
+    {
+        ++acc.haloAbPoints;
+        acc.sumHaloAbStrength += maxChromaDev;
+        acc.sumHaloAbWidth    += haloAbPixelsWidth * params.profileStep;
+    }
 }
 
 } // anonymous namespace
 
 HaloMetrics compute_halo_metrics(const cv::Mat& labRef,
                                  const cv::Mat& labDist,
-                                 const cv::Mat& detailMask)
+                                 const cv::Mat& detailMask,
+                                 const HaloOptions& options)
 {
     CV_Assert(labRef.type() == CV_32FC3);
     CV_Assert(labDist.type() == CV_32FC3);
@@ -127,15 +318,7 @@ HaloMetrics compute_halo_metrics(const cv::Mat& labRef,
     HaloParams params;
     HaloMetrics out;
 
-    // Extract L,a,b channels.
-    cv::Mat L_ref, a_ref, b_ref;
-    cv::Mat L_dist, a_dist, b_dist;
-    cv::extractChannel(labRef,  L_ref,  0);
-    cv::extractChannel(labRef,  a_ref,  1);
-    cv::extractChannel(labRef,  b_ref,  2);
-    cv::extractChannel(labDist, L_dist, 0);
-    cv::extractChannel(labDist, a_dist, 1);
-    cv::extractChannel(labDist, b_dist, 2);
+    CV_Assert(params.profileRadius >= 2 && params.profileRadius <= kMaxProfileRadius);
 
     // Compute L gradients.
     cv::Mat gx, gy, gradMag;
@@ -154,190 +337,119 @@ HaloMetrics compute_halo_metrics(const cv::Mat& labRef,
     const int cols = labRef.cols;
 
     const int R = params.profileRadius;
-    const double step = params.profileStep;
 
-    std::size_t totalEdgePoints = 0;
-    std::size_t haloLPoints     = 0;
-    std::size_t haloAbPoints    = 0;
+    const DirectionLut lut(R, params.profileStep);
+    const std::vector<std::ptrdiff_t> linRef  = lut.linear_offsets(labRef.step1());
+    const std::vector<std::ptrdiff_t> linDist = lut.linear_offsets(labDist.step1());
 
-    double sumHaloLStrength  = 0.0;
-    double sumHaloLWidth     = 0.0;
-    double sumHaloAbStrength = 0.0;
-    double sumHaloAbWidth    = 0.0;
+    // Edge pixels are processed in fixed row bands (the partition does not
+    // depend on the thread count). Each band owns its accumulator and the
+    // partial sums are reduced in band order afterwards, so the result is
+    // bit-identical regardless of how bands are scheduled.
+    const int bandCount = (rows + kHaloBandRows - 1) / kHaloBandRows;
+    std::vector<HaloAccumulator> bandAcc(static_cast<std::size_t>(bandCount));
 
-    for (int y = 0; y < rows; ++y)
+    cv::parallel_for_(cv::Range(0, bandCount), [&](const cv::Range& range)
     {
-        const uchar* mRow   = detailMask.ptr<uchar>(y);
-        const float* gRow   = gradMag.ptr<float>(y);
-        const float* gxRow  = gx.ptr<float>(y);
-        const float* gyRow  = gy.ptr<float>(y);
-
-        for (int x = 0; x < cols; ++x)
+        EdgeProfile prof;
+        for (int band = range.start; band < range.end; ++band)
         {
-            if (mRow[x] == 0)
-                continue;
-
-            float g = gRow[x];
-            if (g < edgeThresh)
-                continue;
-
-            // Edge candidate.
-            ++totalEdgePoints;
-
-            float gxv = gxRow[x];
-            float gyv = gyRow[x];
+            HaloAccumulator& acc = bandAcc[static_cast<std::size_t>(band)];
+            const int y0 = band * kHaloBandRows;
+            const int y1 = std::min(rows, y0 + kHaloBandRows);
 
-            if (gxv == 0.0f && gyv == 0.0f)
-                continue;
-
-            // Normalised normal vector (from dark to bright side, corrected later).
-            double nx = gxv / g;
-            double ny = gyv / g;
-
-            // Sample L_ref on both sides to determine orientation and contrast.
-            // We use small windows around the extremes of the profile.
-            double darkSum = 0.0;
-            double brightSum = 0.0;
-            int darkCount = 0;
-            int brightCount = 0;
-
-            for (int t = -R; t <= -2; ++t)
+            for (int y = y0; y < y1; ++y)
             {
-                double xf = static_cast<double>(x) + t * nx * step;
-                double yf = static_cast<double>(y) + t * ny * step;
-                float Lv = sample_nn(L_ref, static_cast<float>(xf), static_cast<float>(yf));
-                darkSum += Lv;
-                ++darkCount;
-            }
-            for (int t = 2; t <= R; ++t)
-            {
-                double xf = static_cast<double>(x) + t * nx * step;
-                double yf = static_cast<double>(y) + t * ny * step;
-                float Lv = sample_nn(L_ref, static_cast<float>(xf), static_cast<float>(yf));
-                brightSum += Lv;
-                ++brightCount;
-            }
-
-            if (darkCount == 0 || brightCount == 0)
-                continue;
+                const uchar* mRow   = detailMask.ptr<uchar>(y);
+                const float* gRow   = gradMag.ptr<float>(y);
+                const float* gxRow  = gx.ptr<float>(y);
+                const float* gyRow  = gy.ptr<float>(y);
+                const float* refRow  = labRef.ptr<float>(y);
+                const float* distRow = labDist.ptr<float>(y);
 
-            double darkMean   = darkSum   / darkCount;
-            double brightMean = brightSum / brightCount;
+                const bool rowInterior = (y >= lut.reach && y < rows - lut.reach);
 
-            // Ensure orientation: t > 0 goes from dark to bright.
-            if (brightMean < darkMean)
-            {
-                std::swap(darkMean, brightMean);
-                nx = -nx;
-                ny = -ny;
-            }
-
-            double contrastL = brightMean - darkMean;
-            if (contrastL < params.minContrastL)
-                continue;
-
-            // Now sample full profiles for L and ab.
-            double maxOvershootL  = 0.0; // bright side
-            double maxUndershootL = 0.0; // dark side (dist darker than ref)
-
-            double maxChromaDev = 0.0;   // absolute chroma deviation
-
-            int haloLPixelsWidth  = 0;
-            int haloAbPixelsWidth = 0;
-
-            for (int t = -R; t <= R; ++t)
-            {
-                double xf = static_cast<double>(x) + t * nx * step;
-                double yf = static_cast<double>(y) + t * ny * step;
+                for (int x = 0; x < cols; ++x)
+                {
+                    if (mRow[x] == 0)
+                        continue;
 
-                float Lr = sample_nn(L_ref,  static_cast<float>(xf), static_cast<float>(yf));
-                float Ld = sample_nn(L_dist, static_cast<float>(xf), static_cast<float>(yf));
-                float ar = sample_nn(a_ref,  static_cast<float>(xf), static_cast<float>(yf));
-                float ad = sample_nn(a_dist, static_cast<float>(xf), static_cast<float>(yf));
-                float br = sample_nn(b_ref,  static_cast<float>(xf), static_cast<float>(yf));
-                float bd = sample_nn(b_dist, static_cast<float>(xf), static_cast<float>(yf));
+                    float g = gRow[x];
+                    if (g < edgeThresh)
+                        continue;
 
-                double dL = static_cast<double>(Ld - Lr);
+                    float gxv = gxRow[x];
+                    float gyv = gyRow[x];
 
-                if (t > 0)
-                {
-                    // bright side overshoot
-                    if (dL > maxOvershootL)
-                        maxOvershootL = dL;
-                }
-                else if (t < 0)
-                {
-                    // dark side undershoot (dist darker than ref)
-                    double undershoot = static_cast<double>(Lr - Ld);
-                    if (undershoot > maxUndershootL)
-                        maxUndershootL = undershoot;
-                }
+                    const int d = quantize_direction(gxv, gyv);
 
-                double da = static_cast<double>(ad - ar);
-                double db = static_cast<double>(bd - br);
-                double dC = std::sqrt(da * da + db * db);
+                    if (options.thinEdges && !is_gradient_ridge(gradMag, x, y, d, g))
+                        continue;
 
-                if (dC > maxChromaDev)
-                    maxChromaDev = dC;
-            }
+                    // Edge candidate.
+                    ++acc.totalEdgePoints;
 
-            // L halo strength, relative to contrast.
-            double denom = contrastL + params.epsHalo;
-            double haloLPoint = std::max(maxOvershootL, maxUndershootL) / denom;
+                    if (gxv == 0.0f && gyv == 0.0f)
+                        continue;
 
-            bool hasLHalo  = (haloLPoint >= params.haloLThreshold);
-            bool hasAbHalo = (maxChromaDev >= params.haloAbThreshold);
+                    ++acc.profiles;
+                    const std::size_t base = static_cast<std::size_t>(d * lut.length);
 
-            // Compute widths only if we have halo in the corresponding domain.
-            if (hasLHalo || hasAbHalo)
-            {
-                for (int t = -R; t <= R; ++t)
-                {
-                    double xf = static_cast<double>(x) + t * nx * step;
-                    double yf = static_cast<double>(y) + t * ny * step;
-
-                    float Lr = sample_nn(L_ref,  static_cast<float>(xf), static_cast<float>(yf));
-                    float Ld = sample_nn(L_dist, static_cast<float>(xf), static_cast<float>(yf));
-                    float ar = sample_nn(a_ref,  static_cast<float>(xf), static_cast<float>(yf));
-                    float ad = sample_nn(a_dist, static_cast<float>(xf), static_cast<float>(yf));
-                    float br = sample_nn(b_ref,  static_cast<float>(xf), static_cast<float>(yf));
-                    float bd = sample_nn(b_dist, static_cast<float>(xf), static_cast<float>(yf));
-
-                    double dL = std::abs(static_cast<double>(Ld - Lr));
-                    double da = static_cast<double>(ad - ar);
-                    double db = static_cast<double>(bd - br);
-                    double dC = std::sqrt(da * da + db * db);
-
-                    if (hasLHalo)
+                    if (rowInterior && x >= lut.reach && x < cols - lut.reach)
                     {
-                        if (dL >= params.haloLThreshold * contrastL)
-                            ++haloLPixelsWidth;
+                        // Fast path: the whole profile is inside the image.
+                        const float* pr0 = refRow  + 3 * x;
+                        const float* pd0 = distRow + 3 * x;
+                        for (int i = 0; i < lut.length; ++i)
+                        {
+                            const float* pr = pr0 + linRef[base + i];
+                            const float* pd = pd0 + linDist[base + i];
+                            const double da = static_cast<double>(pd[1] - pr[1]);
+                            const double db = static_cast<double>(pd[2] - pr[2]);
+                            prof.Lr[i] = pr[0];
+                            prof.dL[i] = pd[0] - pr[0];
+                            prof.dC[i] = std::sqrt(da * da + db * db);
+                        }
                     }
-
-                    if (hasAbHalo)
+                    else
                     {
-                        if (dC >= params.haloAbThreshold)
-                            ++haloAbPixelsWidth;
+                        // Border path: clamp sample coordinates to the image.
+                        for (int i = 0; i < lut.length; ++i)
+                        {
+                            const cv::Point o = lut.offsets[base + i];
+                            const int sx = std::clamp(x + o.x, 0, cols - 1);
+                            const int sy = std::clamp(y + o.y, 0, rows - 1);
+                            const float* pr = labRef.ptr<float>(sy)  + 3 * sx;
+                            const float* pd = labDist.ptr<float>(sy) + 3 * sx;
+                            const double da = static_cast<double>(pd[1] - pr[1]);
+                            const double db = static_cast<double>(pd[2] - pr[2]);
+                            prof.Lr[i] = pr[0];
+                            prof.dL[i] = pd[0] - pr[0];
+                            prof.dC[i] = std::sqrt(da * da + db * db);
+                        }
                     }
+
+                    accumulate_profile(prof, R, params, acc);
                 }
             }
+        }
+    });
 
-            // Accumulate statistics.
-            if (hasLHalo)
-            {
-                ++haloLPoints;
-                sumHaloLStrength += haloLPoint;
-                sumHaloLWidth    += haloLPixelsWidth * params.profileStep;
-            }
+    HaloAccumulator acc;
+    for (const HaloAccumulator& b : bandAcc)
+        acc.merge(b);
 
-            if (hasAbHalo)
-            {
-                ++haloAbPoints;
-                sumHaloAbStrength += maxChromaDev;
-                sumHaloAbWidth    += haloAbPixelsWidth * params.profileStep;
-            }
-        }
-    }
+    const std::size_t totalEdgePoints = acc.totalEdgePoints;
+    const std::size_t haloLPoints     = acc.haloLPoints;
+    const std::size_t haloAbPoints    = acc.haloAbPoints;
+
+    const double sumHaloLStrength  = acc.sumHaloLStrength;
+    const double sumHaloLWidth     = acc.sumHaloLWidth;
+    const double sumHaloAbStrength = acc.sumHaloAbStrength;
+    const double sumHaloAbWidth    = acc.sumHaloAbWidth;
+
+    out.edge_points        = totalEdgePoints;
+    out.profiles_evaluated = acc.profiles;
 
     if (totalEdgePoints == 0)
         return out;
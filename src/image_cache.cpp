@@ -0,0 +1,275 @@
+#include "iqalab/image_cache.hpp"
+
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <opencv2/imgproc.hpp>
+
+#include "iqalab/lab_disk_cache.hpp"
+#include "iqalab/mapped_image.hpp"
+
+namespace fs = std::filesystem;
+
+namespace iqa
+{
+
+namespace
+{
+
+std::size_t mat_bytes(const cv::Mat& m)
+{
+    return m.empty() ? 0 : m.total() * m.elemSize();
+}
+
+// Identity of a file on disk for cache validation. False if it cannot be stat'ed.
+bool file_signature(const fs::path& path, std::string& key,
+                    std::int64_t& mtime, std::uintmax_t& fileSize)
+{
+    std::error_code ec;
+    const fs::path abs = fs::absolute(path, ec);
+    key = (ec ? path : abs).lexically_normal().generic_string();
+
+    const auto t = fs::last_write_time(path, ec);
+    if (ec)
+        return false;
+    fileSize = fs::file_size(path, ec);
+    if (ec)
+        return false;
+    mtime = static_cast<std::int64_t>(t.time_since_epoch().count());
+    return true;
+}
+
+} // anonymous namespace
+
+cv::Mat lab32_from_bgr8(const cv::Mat& bgr)
+{
+    CV_Assert(bgr.type() == CV_8UC3);
+    cv::Mat lab8, lab32;
+    cv::cvtColor(bgr, lab8, cv::COLOR_BGR2Lab);
+    lab8.convertTo(lab32, CV_32FC3);
+    return lab32;
+}
+
+cv::Mat read_image_lab32(const fs::path& path)
+{
+    MappedImage raw;
+    bool mapped = false;
+    try {
+        mapped = map_raw_image(path, raw);
+    } catch (const std::runtime_error&) {
+        return cv::Mat();
+    }
+    if (!mapped) {
+        const cv::Mat bgr = read_image_bgr(path);
+        return bgr.empty() ? cv::Mat() : lab32_from_bgr8(bgr);
+    }
+
+    // cvtColor reads the mapped rows directly; BGR2Lab ignores the 4th
+    // byte of BGRX input and RGB2Lab is BGR2Lab with the channels swapped,
+    // so the result equals lab32_from_bgr8() of the BGR image.
+    cv::Mat lab8;
+    switch (raw.order) {
+    case PixelOrder::Bgr:
+    case PixelOrder::Bgrx:
+        cv::cvtColor(raw.pixels, lab8, cv::COLOR_BGR2Lab);
+        break;
+    case PixelOrder::Rgb:
+        cv::cvtColor(raw.pixels, lab8, cv::COLOR_RGB2Lab);
+        break;
+    case PixelOrder::Gray: {
+        cv::Mat bgr;
+        cv::cvtColor(raw.pixels, bgr, cv::COLOR_GRAY2BGR);
+        cv::cvtColor(bgr, lab8, cv::COLOR_BGR2Lab);
+        break;
+    }
+    }
+
+    cv::Mat lab32;
+    lab8.convertTo(lab32, CV_32FC3);
+    return lab32;
+}
+
+ImageCache::ImageCache(std::size_t byteBudget)
+    : m_byteBudget(byteBudget)
+{
+}
+
+cv::Mat ImageCache::load_bgr(const fs::path& path)
+{
+    Entry entry;
+    if (!file_signature(path, entry.key, entry.mtime, entry.fileSize)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.failed;
+        return cv::Mat();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Entry* e = find_locked(entry.key, entry.mtime, entry.fileSize);
+        if (e != nullptr && !e->bgr.empty()) {
+            ++m_stats.hits;
+            return e->bgr;
+        }
+    }
+
+    entry.bgr = read_image_bgr(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cv::Mat bgr = entry.bgr;
+    if (bgr.empty()) {
+        ++m_stats.failed;
+        return bgr;
+    }
+    ++m_stats.misses;
+
+    Entry* e = find_locked(entry.key, entry.mtime, entry.fileSize);
+    if (e != nullptr && e->bgr.empty()) {
+        // Lab-only entry from the disk cache; attach the BGR to it.
+        e->bgr = bgr;
+        m_stats.bytes += mat_bytes(bgr);
+        evict_locked();
+    } else if (e == nullptr) {
+        store_locked(std::move(entry));
+    }
+    return bgr;
+}
+
+cv::Mat ImageCache::load_lab32(const fs::path& path)
+{
+    Entry entry;
+    if (!file_signature(path, entry.key, entry.mtime, entry.fileSize)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.failed;
+        return cv::Mat();
+    }
+
+    // Where the Lab came from, for the stats; converting a cached BGR
+    // counts as the memory hit above.
+    enum class Source { Memory, Disk, Decoded } source = Source::Memory;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (const Entry* e = find_locked(entry.key, entry.mtime, entry.fileSize)) {
+            ++m_stats.hits;
+            if (!e->lab32.empty())
+                return e->lab32;
+            entry.bgr = e->bgr;
+        }
+    }
+
+    if (entry.bgr.empty() && m_diskCache != nullptr) {
+        // Decode and conversion happen inside the disk cache on its misses.
+        bool fromFile = false;
+        entry.lab32 = m_diskCache->load_lab32(path, &fromFile);
+        source = fromFile ? Source::Disk : Source::Decoded;
+    } else if (entry.bgr.empty()) {
+        // Lab only: no BGR copy is kept (load_bgr() attaches one later).
+        entry.lab32 = read_image_lab32(path);
+        source = Source::Decoded;
+    } else {
+        entry.lab32 = lab32_from_bgr8(entry.bgr);
+        if (m_diskCache != nullptr)
+            m_diskCache->store(path, entry.lab32);
+    }
+
+    cv::Mat lab32 = entry.lab32;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (lab32.empty()) {
+        ++m_stats.failed;
+        return lab32;
+    }
+    if (source == Source::Disk)
+        ++m_stats.diskHits;
+    else if (source == Source::Decoded)
+        ++m_stats.misses;
+
+    Entry* e = find_locked(entry.key, entry.mtime, entry.fileSize);
+    if (e != nullptr && e->lab32.empty()) {
+        // Another lookup may have stored the BGR meanwhile; attach Lab to it.
+        e->lab32 = lab32;
+        m_stats.bytes += mat_bytes(lab32);
+        evict_locked();
+    } else if (e == nullptr) {
+        store_locked(std::move(entry));
+    }
+    return lab32;
+}
+
+ImageCache::Stats ImageCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats s = m_stats;
+    s.entries = m_entries.size();
+    return s;
+}
+
+void ImageCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_stats.bytes = 0;
+}
+
+ImageCache::Entry* ImageCache::find_locked(const std::string& key,
+                                           std::int64_t mtime,
+                                           std::uintmax_t fileSize)
+{
+    const auto it = m_index.find(key);
+    if (it == m_index.end())
+        return nullptr;
+
+    if (it->second->mtime != mtime || it->second->fileSize != fileSize) {
+        // Stale: the file changed on disk.
+        erase_locked(it->second);
+        return nullptr;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return &m_entries.front();
+}
+
+void ImageCache::store_locked(Entry entry)
+{
+    const auto it = m_index.find(entry.key);
+    if (it != m_index.end())
+        erase_locked(it->second);
+
+    const std::size_t bytes = mat_bytes(entry.bgr) + mat_bytes(entry.lab32);
+    if (bytes > m_byteBudget)
+        return;
+
+    m_entries.push_front(std::move(entry));
+    m_index[m_entries.front().key] = m_entries.begin();
+    m_stats.bytes += bytes;
+    evict_locked();
+}
+
+void ImageCache::erase_locked(EntryList::iterator it)
+{
+    m_stats.bytes -= mat_bytes(it->bgr) + mat_bytes(it->lab32);
+    m_index.erase(it->key);
+    m_entries.erase(it);
+}
+
+void ImageCache::evict_locked()
+{
+    while (m_stats.bytes > m_byteBudget && !m_entries.empty()) {
+        erase_locked(std::prev(m_entries.end()));
+        ++m_stats.evictions;
+    }
+}
+
+void write_image_cache_stats(std::ostream& os, const ImageCache::Stats& stats)
+{
+    os << "image cache: " << stats.hits << " hits, "
+       << stats.misses << " decoded, "
+       << stats.diskHits << " from lab cache, "
+       << stats.failed << " unreadable, "
+       << stats.evictions << " evicted\n";
+}
+
+} // namespace iqa
@@ -3,7 +3,11 @@
 #include "iqalab/utils/path_utils.hpp"
 
 #include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <vector>
 
 const char *iqa::to_string(ImageType t) {
   switch (t) {
@@ -139,4 +143,277 @@ bool iqa::is_image_file(const std::string &path) {
   default:
     return false;
   }
-}
\ No newline at end of file
+}
+namespace {
+
+inline std::uint32_t be16(const unsigned char *p) {
+  return (std::uint32_t(p[0]) << 8) | p[1];
+}
+inline std::uint32_t be32(const unsigned char *p) {
+  return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+         (std::uint32_t(p[2]) << 8) | p[3];
+}
+inline std::uint32_t le16(const unsigned char *p) {
+  return (std::uint32_t(p[1]) << 8) | p[0];
+}
+inline std::uint32_t le24(const unsigned char *p) {
+  return (std::uint32_t(p[2]) << 16) | (std::uint32_t(p[1]) << 8) | p[0];
+}
+inline std::uint32_t le32(const unsigned char *p) {
+  return (std::uint32_t(p[3]) << 24) | (std::uint32_t(p[2]) << 16) |
+         (std::uint32_t(p[1]) << 8) | p[0];
+}
+
+bool read_at(std::ifstream &f, std::streamoff off, unsigned char *dst,
+             std::size_t n) {
+  f.clear();
+  f.seekg(off);
+  f.read(reinterpret_cast<char *>(dst), static_cast<std::streamsize>(n));
+  return static_cast<std::size_t>(f.gcount()) == n;
+}
+
+// Walk the JPEG marker segments up to the first SOFn.
+void probe_jpeg(std::ifstream &f, iqa::ImageInfo &info) {
+  std::streamoff pos = 2;
+  unsigned char m[2];
+  while (read_at(f, pos, m, 2)) {
+    if (m[0] != 0xFF)
+      return;
+    if (m[1] == 0xFF) { // fill byte
+      ++pos;
+      continue;
+    }
+    pos += 2;
+    if (m[1] == 0xD8 || m[1] == 0x01 || (m[1] >= 0xD0 && m[1] <= 0xD7))
+      continue; // no length field
+
+    unsigned char seg[8];
+    if (!read_at(f, pos, seg, 2))
+      return;
+    const std::uint32_t len = be16(seg);
+    if (len < 2)
+      return;
+
+    const bool sof = m[1] >= 0xC0 && m[1] <= 0xCF && m[1] != 0xC4 &&
+                     m[1] != 0xC8 && m[1] != 0xCC;
+    if (sof) {
+      // length(2) precision(1) height(2) width(2) components(1)
+      if (!read_at(f, pos, seg, 8))
+        return;
+      info.bitDepth = seg[2];
+      info.height = static_cast<int>(be16(seg + 3));
+      info.width = static_cast<int>(be16(seg + 5));
+      info.channels = seg[7];
+      return;
+    }
+    pos += len;
+  }
+}
+
+void probe_png(const unsigned char *h, std::size_t n, iqa::ImageInfo &info) {
+  if (n < 26 || std::memcmp(h + 12, "IHDR", 4) != 0)
+    return;
+  info.width = static_cast<int>(be32(h + 16));
+  info.height = static_cast<int>(be32(h + 20));
+  info.bitDepth = h[24];
+  switch (h[25]) {  // colour type
+  case 0: info.channels = 1; break;
+  case 2: info.channels = 3; break;
+  case 3: info.channels = 3; info.bitDepth = 8; break;  // palette
+  case 4: info.channels = 2; break;
+  case 6: info.channels = 4; break;
+  default: break;
+  }
+}
+
+void probe_bmp(const unsigned char *h, std::size_t n, iqa::ImageInfo &info) {
+  if (n < 26)
+    return;
+  std::uint32_t bpp = 0;
+  if (le32(h + 14) == 12) { // BITMAPCOREHEADER
+    info.width = static_cast<int>(le16(h + 18));
+    info.height = static_cast<int>(le16(h + 20));
+    bpp = le16(h + 24);
+  } else {
+    if (n < 30)
+      return;
+    info.width = static_cast<std::int32_t>(le32(h + 18));
+    info.height = std::abs(static_cast<std::int32_t>(le32(h + 22))); // < 0: top-down
+    bpp = le16(h + 28);
+  }
+  info.channels = bpp == 32 ? 4 : 3;  // <= 8 bpp: palette
+  info.bitDepth = 8;
+}
+
+// First IFD of a TIFF: ImageWidth, ImageLength, BitsPerSample, SamplesPerPixel.
+void probe_tiff(std::ifstream &f, const unsigned char *h, iqa::ImageInfo &info) {
+  const bool le = h[0] == 'I';
+  auto u16 = [le](const unsigned char *p) { return le ? le16(p) : be16(p); };
+  auto u32 = [le](const unsigned char *p) { return le ? le32(p) : be32(p); };
+
+  const std::uint32_t ifd = u32(h + 4);
+  unsigned char cnt[2];
+  if (!read_at(f, ifd, cnt, 2))
+    return;
+  const std::uint32_t entries = std::min<std::uint32_t>(u16(cnt), 256);
+
+  std::vector<unsigned char> dir(entries * 12);
+  if (!read_at(f, ifd + 2, dir.data(), dir.size()))
+    return;
+
+  int samples = 1;
+  int bits = 1;
+  for (std::uint32_t i = 0; i < entries; ++i) {
+    const unsigned char *e = dir.data() + i * 12;
+    const std::uint32_t tag = u16(e);
+    const std::uint32_t type = u16(e + 2);
+    const std::uint32_t count = u32(e + 4);
+    // SHORT values are left-aligned in the 4-byte value field.
+    const std::uint32_t value = type == 3 ? u16(e + 8) : u32(e + 8);
+
+    switch (tag) {
+    case 256: info.width = static_cast<int>(value); break;
+    case 257: info.height = static_cast<int>(value); break;
+    case 277: samples = static_cast<int>(value); break;
+    case 258:
+      if (type == 3 && count > 2) { // array of SHORTs stored at an offset
+        unsigned char b[2];
+        if (read_at(f, u32(e + 8), b, 2))
+          bits = static_cast<int>(u16(b));
+      } else {
+        bits = static_cast<int>(value);
+      }
+      break;
+    default: break;
+    }
+  }
+  info.channels = samples;
+  info.bitDepth = bits;
+}
+
+void probe_webp(const unsigned char *h, std::size_t n, iqa::ImageInfo &info) {
+  if (n < 30)
+    return;
+  info.bitDepth = 8;
+  if (std::memcmp(h + 12, "VP8 ", 4) == 0) {
+    // Lossy: frame tag (3), start code 9d 01 2a, 14-bit width / height.
+    if (h[23] != 0x9D || h[24] != 0x01 || h[25] != 0x2A)
+      return;
+    info.width = static_cast<int>(le16(h + 26) & 0x3FFF);
+    info.height = static_cast<int>(le16(h + 28) & 0x3FFF);
+    info.channels = 3;
+  } else if (std::memcmp(h + 12, "VP8L", 4) == 0) {
+    // Lossless: signature 0x2f, then 14-bit width-1, 14-bit height-1, alpha bit.
+    if (h[20] != 0x2F)
+      return;
+    const std::uint32_t bits = le32(h + 21);
+    info.width = static_cast<int>((bits & 0x3FFF) + 1);
+    info.height = static_cast<int>(((bits >> 14) & 0x3FFF) + 1);
+    info.channels = (bits >> 28) & 1 ? 4 : 3;
+  } else if (std::memcmp(h + 12, "VP8X", 4) == 0) {
+    // Extended: flags, reserved, 24-bit canvas width-1 / height-1.
+    info.width = static_cast<int>(le24(h + 24) + 1);
+    info.height = static_cast<int>(le24(h + 27) + 1);
+    info.channels = (h[20] & 0x10) ? 4 : 3;
+  }
+}
+
+// Next decimal header token of a PNM file, skipping whitespace and comments.
+bool pnm_token(const unsigned char *h, std::size_t n, std::size_t &pos,
+               long &value) {
+  for (;;) {
+    while (pos < n && std::isspace(h[pos]))
+      ++pos;
+    if (pos < n && h[pos] == '#') {
+      while (pos < n && h[pos] != '\n')
+        ++pos;
+      continue;
+    }
+    break;
+  }
+  if (pos >= n || !std::isdigit(h[pos]))
+    return false;
+  value = 0;
+  while (pos < n && std::isdigit(h[pos]) && value < (1L << 30))
+    value = value * 10 + (h[pos++] - '0');
+  return true;
+}
+
+void probe_pnm(const unsigned char *h, std::size_t n, iqa::ImageInfo &info) {
+  const char kind = static_cast<char>(h[1]);
+  std::size_t pos = 2;
+  long w = 0, ht = 0, maxval = 1;
+  if (!pnm_token(h, n, pos, w) || !pnm_token(h, n, pos, ht))
+    return;
+  const bool bitmap = kind == '1' || kind == '4';
+  if (!bitmap && !pnm_token(h, n, pos, maxval))
+    return;
+
+  info.width = static_cast<int>(w);
+  info.height = static_cast<int>(ht);
+  info.channels = (kind == '3' || kind == '6') ? 3 : 1;
+  info.bitDepth = bitmap ? 1 : (maxval > 255 ? 16 : 8);
+}
+
+} // namespace
+
+iqa::ImageInfo iqa::probe_image(const std::filesystem::path &p) {
+  ImageInfo info;
+  std::ifstream f(p, std::ios::binary);
+  if (!f)
+    return info;
+
+  // Enough for every fixed-offset header and typical PNM comments.
+  unsigned char h[512] = {0};
+  f.read(reinterpret_cast<char *>(h), sizeof(h));
+  const std::size_t n = static_cast<std::size_t>(f.gcount());
+
+  if (n >= 3 && h[0] == 0xFF && h[1] == 0xD8 && h[2] == 0xFF) {
+    info.type = ImageType::Jpeg;
+    probe_jpeg(f, info);
+  } else if (n >= 8 && std::memcmp(h, "\x89PNG\r\n\x1a\n", 8) == 0) {
+    info.type = ImageType::Png;
+    probe_png(h, n, info);
+  } else if (n >= 2 && h[0] == 'B' && h[1] == 'M') {
+    info.type = ImageType::Bmp;
+    probe_bmp(h, n, info);
+  } else if (n >= 8 && ((h[0] == 'I' && h[1] == 'I' && h[2] == 0x2A && h[3] == 0) ||
+                        (h[0] == 'M' && h[1] == 'M' && h[2] == 0 && h[3] == 0x2A))) {
+    info.type = ImageType::Tiff;
+    probe_tiff(f, h, info);
+  } else if (n >= 12 && std::memcmp(h, "RIFF", 4) == 0 &&
+             std::memcmp(h + 8, "WEBP", 4) == 0) {
+    info.type = ImageType::Webp;
+    probe_webp(h, n, info);
+  } else if (n >= 10 && (std::memcmp(h, "GIF87a", 6) == 0 ||
+                         std::memcmp(h, "GIF89a", 6) == 0)) {
+    info.type = ImageType::Gif;
+    info.width = static_cast<int>(le16(h + 6));
+    info.height = static_cast<int>(le16(h + 8));
+    info.channels = 3;
+    info.bitDepth = 8;
+  } else if (n >= 3 && h[0] == 'P' && h[1] >= '1' && h[1] <= '6') {
+    info.type = ImageType::Pnm;
+    probe_pnm(h, n, info);
+  } else if (n >= 12 && (std::memcmp(h + 4, "jP  ", 4) == 0 ||
+                         (h[0] == 0xFF && h[1] == 0x4F && h[2] == 0xFF && h[3] == 0x51))) {
+    info.type = ImageType::Jp2;
+  } else if (n >= 12 && std::memcmp(h + 4, "ftypavif", 8) == 0) {
+    info.type = ImageType::Avif;
+  }
+
+  if (!info.has_size()) {
+    info.width = 0;
+    info.height = 0;
+  }
+  return info;
+}
+
+bool iqa::probed_sizes_differ(const ImageInfo& a, const ImageInfo& b) {
+  if (!a.has_size() || !b.has_size())
+    return false;
+  if (a.width == b.width && a.height == b.height)
+    return false;
+  // Possibly an EXIF rotation applied on decode.
+  return !(a.width == b.height && a.height == b.width);
+}
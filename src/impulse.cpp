@@ -2,6 +2,7 @@
 #include <cassert>
 #include <iostream>
 #include <opencv2/imgcodecs.hpp>
+#include "iqalab/utils/bit_mask.hpp"
 #include "iqalab/utils/mask_utils.hpp"
 
 namespace iqa {
@@ -160,9 +161,31 @@ cv::Mat impulse_to_mask_bgr32(const cv::Mat& refBGR32,
 }
 
 
+// The strict detection only feeds the loose/strict ratio, so its mask is
+// kept bit-packed: one scratch row is unpacked at a time.
+static BitMask impulse_to_bitmask_bgr32(const cv::Mat& refBGR32,
+                                        const cv::Mat& distBGR32, bool strict)
+{
+    CV_Assert(refBGR32.size() == distBGR32.size());
+    CV_Assert(refBGR32.type() == CV_32FC3 && distBGR32.type() == CV_32FC3);
+
+    const int rows = distBGR32.rows;
+    const int cols = distBGR32.cols;
+
+    BitMask mask(rows, cols);
+    std::vector<uchar> rowOut(static_cast<std::size_t>(cols));
+    for (int y = 0; y < rows; ++y) {
+        detect_impulses_row_to_mask(cols, refBGR32.ptr<cv::Vec3f>(y),
+                                    distBGR32.ptr<cv::Vec3f>(y), rowOut.data(), strict);
+        mask.assign_row(y, rowOut.data());
+    }
+    return mask;
+}
+
+
 struct DualImpulseStats {
     cv::Mat maskLoose;   // mask0
-    cv::Mat maskStrict;    // mask1
+    BitMask maskStrict;    // mask1
     std::size_t nImpLoose;
     std::size_t nImpStrict;
     double ratio;
@@ -175,10 +198,10 @@ static DualImpulseStats compute_dual_impulse_stats_bgr32(
     DualImpulseStats s;
 
     s.maskLoose = impulse_to_mask_bgr32(refBGR32, distBGR32, false);
-    s.maskStrict  = impulse_to_mask_bgr32(refBGR32, distBGR32, true);
+    s.maskStrict  = impulse_to_bitmask_bgr32(refBGR32, distBGR32, true);
 
     s.nImpLoose = count_impulses(s.maskLoose);
-    s.nImpStrict  = count_impulses(s.maskStrict);
+    s.nImpStrict  = s.maskStrict.count();
 
     s.ratio = (static_cast<double>(s.nImpLoose) + 0.1) /
               (static_cast<double>(s.nImpStrict)  + 0.1);
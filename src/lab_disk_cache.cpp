@@ -0,0 +1,285 @@
+#include "iqalab/lab_disk_cache.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include "iqalab/image_cache.hpp"
+#include "iqalab/utils/content_hash.hpp"
+#include "iqalab/utils/mapped_file.hpp"
+
+namespace fs = std::filesystem;
+
+namespace iqa
+{
+
+namespace
+{
+
+constexpr char kLabMagic[4] = { 'I', 'Q', 'L', 'B' };
+constexpr std::uint32_t kLabVersion = 1;
+
+constexpr std::uint32_t kStorageFloat32 = 0;
+constexpr std::uint32_t kStorageFloat16 = 1;
+
+// On-disk header; all fields are naturally aligned, sizeof == 64 so the
+// samples that follow are aligned for float access in the mapping.
+struct LabHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint64_t pathKey;
+    std::int64_t  sourceMtime;
+    std::uint64_t sourceSize;
+    std::int32_t  rows;
+    std::int32_t  cols;
+    std::uint32_t storage;
+    std::uint32_t channels;
+    std::uint64_t reserved[2];
+};
+static_assert(sizeof(LabHeader) == 64, "LabHeader layout");
+
+// Identity of the source file; the cache file is current only if both match.
+struct SourceSignature
+{
+    std::string key;   // absolute, normalized path
+    std::int64_t mtime = 0;
+    std::uint64_t size = 0;
+};
+
+bool source_signature(const fs::path& source, SourceSignature& sig)
+{
+    std::error_code ec;
+    const fs::path abs = fs::absolute(source, ec);
+    sig.key = (ec ? source : abs).lexically_normal().generic_string();
+
+    const auto t = fs::last_write_time(source, ec);
+    if (ec)
+        return false;
+    sig.size = static_cast<std::uint64_t>(fs::file_size(source, ec));
+    if (ec)
+        return false;
+    sig.mtime = static_cast<std::int64_t>(t.time_since_epoch().count());
+    return true;
+}
+
+std::uint64_t path_key(const SourceSignature& sig)
+{
+    return utils::hash_string(sig.key, kLabVersion);
+}
+
+fs::path cache_file(const fs::path& cacheDir, const SourceSignature& sig)
+{
+    return cacheDir / (utils::hash_to_hex(path_key(sig)) + ".iqlab");
+}
+
+std::size_t sample_bytes(std::uint32_t storage)
+{
+    return storage == kStorageFloat16 ? 2 : 4;
+}
+
+// Read the cache file for `sig`. `stale` is set when a valid file exists
+// but belongs to an older version of the source.
+bool read_lab_file(const fs::path& file, const SourceSignature& sig,
+                   cv::Mat& lab32, bool& stale)
+{
+    stale = false;
+
+    std::error_code ec;
+    if (!fs::is_regular_file(file, ec))
+        return false;
+
+    utils::MappedFile mapped;
+    try {
+        mapped = utils::MappedFile(file);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    if (mapped.size() < sizeof(LabHeader))
+        return false;
+
+    LabHeader h;
+    std::memcpy(&h, mapped.data(), sizeof(h));
+    if (std::memcmp(h.magic, kLabMagic, sizeof(kLabMagic)) != 0 ||
+        h.version != kLabVersion || h.pathKey != path_key(sig) ||
+        h.channels != 3 || h.rows <= 0 || h.cols <= 0 ||
+        (h.storage != kStorageFloat32 && h.storage != kStorageFloat16))
+        return false;
+
+    const std::size_t samples = static_cast<std::size_t>(h.rows) *
+                                static_cast<std::size_t>(h.cols) * 3;
+    if (mapped.size() != sizeof(LabHeader) + samples * sample_bytes(h.storage))
+        return false;
+
+    if (h.sourceMtime != sig.mtime || h.sourceSize != sig.size) {
+        stale = true;
+        return false;
+    }
+
+    // Wrap the mapped samples and copy (or widen) them out; the mapping is
+    // released when `mapped` goes out of scope.
+    unsigned char* base = const_cast<unsigned char*>(mapped.data()) + sizeof(LabHeader);
+    if (h.storage == kStorageFloat32)
+        cv::Mat(h.rows, h.cols, CV_32FC3, base).copyTo(lab32);
+    else
+        cv::Mat(h.rows, h.cols, CV_16FC3, base).convertTo(lab32, CV_32F);
+    return true;
+}
+
+void write_lab_file(const fs::path& file, const SourceSignature& sig,
+                    const cv::Mat& lab32, std::uint32_t storage)
+{
+    CV_Assert(lab32.type() == CV_32FC3);
+    CV_Assert(!lab32.empty());
+
+    cv::Mat samples = lab32;
+    if (storage == kStorageFloat16)
+        lab32.convertTo(samples, CV_16F);
+
+    LabHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, kLabMagic, sizeof(kLabMagic));
+    h.version = kLabVersion;
+    h.pathKey = path_key(sig);
+    h.sourceMtime = sig.mtime;
+    h.sourceSize = sig.size;
+    h.rows = samples.rows;
+    h.cols = samples.cols;
+    h.storage = storage;
+    h.channels = 3;
+
+    // Unique temporary name per writer, renamed into place when complete.
+    const std::size_t salt =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+        static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    fs::path tmp = file;
+    tmp += ".tmp" + utils::hash_to_hex(salt);
+
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os)
+            return;
+
+        os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+        const std::size_t rowBytes = static_cast<std::size_t>(samples.cols) * samples.elemSize();
+        for (int y = 0; y < samples.rows; ++y)
+            os.write(reinterpret_cast<const char*>(samples.ptr(y)),
+                     static_cast<std::streamsize>(rowBytes));
+
+        if (!os) {
+            os.close();
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec)
+        fs::remove(tmp, ec);
+}
+
+std::uint32_t storage_code(Lab32DiskCache::Storage storage)
+{
+    return storage == Lab32DiskCache::Storage::Float16 ? kStorageFloat16 : kStorageFloat32;
+}
+
+} // anonymous namespace
+
+Lab32DiskCache::Lab32DiskCache(fs::path cacheDir, Storage storage)
+    : m_cacheDir(std::move(cacheDir))
+    , m_storage(storage)
+{
+    fs::create_directories(m_cacheDir);
+}
+
+fs::path Lab32DiskCache::file_path(const fs::path& source) const
+{
+    // Only the path enters the file name; a failed stat leaves it usable.
+    SourceSignature sig;
+    source_signature(source, sig);
+    return cache_file(m_cacheDir, sig);
+}
+
+cv::Mat Lab32DiskCache::load_lab32(const fs::path& source, bool* fromFile)
+{
+    if (fromFile != nullptr)
+        *fromFile = false;
+
+    // Stat before decoding: if the source changes meanwhile, the stored
+    // signature is already outdated and the next run recomputes.
+    SourceSignature sig;
+    if (!source_signature(source, sig)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.misses;
+        return cv::Mat();
+    }
+
+    const fs::path file = cache_file(m_cacheDir, sig);
+
+    cv::Mat lab32;
+    bool stale = false;
+    if (read_lab_file(file, sig, lab32, stale)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.hits;
+        if (fromFile != nullptr)
+            *fromFile = true;
+        return lab32;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.misses;
+        if (stale)
+            ++m_stats.stale;
+    }
+
+    lab32 = read_image_lab32(source);
+    if (lab32.empty())
+        return cv::Mat();
+
+    write_lab_file(file, sig, lab32, storage_code(m_storage));
+    return lab32;
+}
+
+bool Lab32DiskCache::lookup(const fs::path& source, cv::Mat& lab32)
+{
+    SourceSignature sig;
+    if (!source_signature(source, sig))
+        return false;
+
+    bool stale = false;
+    const fs::path file = cache_file(m_cacheDir, sig);
+    if (!read_lab_file(file, sig, lab32, stale))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.hits;
+    return true;
+}
+
+void Lab32DiskCache::store(const fs::path& source, const cv::Mat& lab32)
+{
+    SourceSignature sig;
+    if (!source_signature(source, sig))
+        return;
+
+    write_lab_file(cache_file(m_cacheDir, sig), sig, lab32, storage_code(m_storage));
+}
+
+Lab32DiskCache::Stats Lab32DiskCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace iqa
@@ -0,0 +1,193 @@
+#include "iqalab/mapped_image.hpp"
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace iqa
+{
+
+namespace
+{
+
+inline std::uint32_t le_u16(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8);
+}
+
+inline std::uint32_t le_u32(const unsigned char* p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+// Pixel array of an uncompressed 24/32-bit BMP. Rows are 4-byte aligned,
+// stored bottom-up unless the height is negative.
+bool map_bmp(const std::shared_ptr<const utils::MappedFile>& file, MappedImage& out)
+{
+    const unsigned char* d = file->data();
+    const std::size_t size = file->size();
+    if (size < 54 || d[0] != 'B' || d[1] != 'M')
+        return false;
+
+    const std::uint32_t offset      = le_u32(d + 10);
+    const std::uint32_t headerSize  = le_u32(d + 14);
+    const std::int32_t  width       = static_cast<std::int32_t>(le_u32(d + 18));
+    const std::int32_t  rawHeight   = static_cast<std::int32_t>(le_u32(d + 22));
+    const std::uint32_t bpp         = le_u16(d + 28);
+    const std::uint32_t compression = le_u32(d + 30);
+
+    if (headerSize < 40 || compression != 0 || (bpp != 24 && bpp != 32))
+        return false;
+    if (width <= 0 || rawHeight == 0 || rawHeight == INT32_MIN)
+        return false;
+
+    const bool topDown = rawHeight < 0;
+    const int w = width;
+    const int h = topDown ? -rawHeight : rawHeight;
+    const int channels = static_cast<int>(bpp / 8);
+    const std::size_t step = ((static_cast<std::size_t>(w) * bpp + 31) / 32) * 4;
+    if (offset > size || step * static_cast<std::size_t>(h) > size - offset)
+        return false;
+
+    const int type = CV_8UC(channels);
+    unsigned char* base = const_cast<unsigned char*>(d + offset);
+
+    out.order = channels == 3 ? PixelOrder::Bgr : PixelOrder::Bgrx;
+    if (topDown) {
+        out.pixels = cv::Mat(h, w, type, base, step);
+        out.zeroCopy = true;
+        out.mapping = file;
+    } else {
+        out.pixels.create(h, w, type);
+        const std::size_t rowBytes = static_cast<std::size_t>(w) * channels;
+        for (int y = 0; y < h; ++y)
+            std::memcpy(out.pixels.ptr(y), base + step * static_cast<std::size_t>(h - 1 - y), rowBytes);
+        out.zeroCopy = false;
+        out.mapping.reset();
+    }
+    return true;
+}
+
+// Next whitespace-separated header token of a PNM file, skipping comments.
+bool pnm_token(const unsigned char* d, std::size_t size, std::size_t& pos, long& value)
+{
+    for (;;) {
+        while (pos < size && std::isspace(d[pos]))
+            ++pos;
+        if (pos < size && d[pos] == '#') {
+            while (pos < size && d[pos] != '\n')
+                ++pos;
+            continue;
+        }
+        break;
+    }
+    if (pos >= size || !std::isdigit(d[pos]))
+        return false;
+
+    value = 0;
+    while (pos < size && std::isdigit(d[pos])) {
+        value = value * 10 + (d[pos] - '0');
+        if (value > (1L << 30))
+            return false;
+        ++pos;
+    }
+    return true;
+}
+
+// Binary PGM (P5) / PPM (P6) with 8-bit samples: rows are contiguous.
+bool map_pnm(const std::shared_ptr<const utils::MappedFile>& file, MappedImage& out)
+{
+    const unsigned char* d = file->data();
+    const std::size_t size = file->size();
+    if (size < 3 || d[0] != 'P' || (d[1] != '5' && d[1] != '6'))
+        return false;
+
+    std::size_t pos = 2;
+    long w = 0, h = 0, maxval = 0;
+    if (!pnm_token(d, size, pos, w) || !pnm_token(d, size, pos, h) ||
+        !pnm_token(d, size, pos, maxval))
+        return false;
+    // cv::imread rescales samples of other maxvals to 0..255; leave those
+    // to it.
+    if (w <= 0 || h <= 0 || maxval != 255)
+        return false;
+    // Exactly one whitespace byte separates the header from the raster.
+    if (pos >= size || !std::isspace(d[pos]))
+        return false;
+    ++pos;
+
+    const int channels = d[1] == '6' ? 3 : 1;
+    const std::size_t step = static_cast<std::size_t>(w) * channels;
+    if (step * static_cast<std::size_t>(h) > size - pos)
+        return false;
+
+    out.pixels = cv::Mat(static_cast<int>(h), static_cast<int>(w), CV_8UC(channels),
+                         const_cast<unsigned char*>(d + pos), step);
+    out.order = channels == 3 ? PixelOrder::Rgb : PixelOrder::Gray;
+    out.zeroCopy = true;
+    out.mapping = file;
+    return true;
+}
+
+} // anonymous namespace
+
+bool map_raw_image(const std::filesystem::path& path, MappedImage& out)
+{
+    // Sniff the signature with a small read first: compressed formats are
+    // never mapped (or, without mmap, read into memory only to be decoded
+    // from the file again by cv::imread).
+    char magic[2] = { 0, 0 };
+    {
+        std::ifstream is(path, std::ios::binary);
+        if (!is)
+            throw std::runtime_error("map_raw_image: cannot open " + path.string());
+        if (!is.read(magic, sizeof(magic)))
+            return false;
+    }
+    const bool bmp = magic[0] == 'B' && magic[1] == 'M';
+    const bool pnm = magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6');
+    if (!bmp && !pnm)
+        return false;
+
+    auto file = std::make_shared<const utils::MappedFile>(path);
+    return bmp ? map_bmp(file, out) : map_pnm(file, out);
+}
+
+cv::Mat read_image_bgr(const std::filesystem::path& path)
+{
+    MappedImage raw;
+    bool mapped = false;
+    try {
+        mapped = map_raw_image(path, raw);
+    } catch (const std::runtime_error&) {
+        return cv::Mat();
+    }
+    if (!mapped)
+        return cv::imread(path.string(), cv::IMREAD_COLOR);
+
+    cv::Mat bgr;
+    switch (raw.order) {
+    case PixelOrder::Bgr:
+        // Bottom-up BMPs were already copied (and flipped) out of the mapping.
+        bgr = raw.zeroCopy ? raw.pixels.clone() : raw.pixels;
+        break;
+    case PixelOrder::Rgb:
+        cv::cvtColor(raw.pixels, bgr, cv::COLOR_RGB2BGR);
+        break;
+    case PixelOrder::Bgrx:
+        cv::cvtColor(raw.pixels, bgr, cv::COLOR_BGRA2BGR);
+        break;
+    case PixelOrder::Gray:
+        cv::cvtColor(raw.pixels, bgr, cv::COLOR_GRAY2BGR);
+        break;
+    }
+    return bgr;
+}
+
+} // namespace iqa
@@ -97,4 +97,77 @@ double lab_channel_mse(const cv::Mat& labRef,
     return static_cast<double>(meanDiff2[0]);
   }
 }
+
+double lab_channel_mse(const cv::Mat& labRef,
+                       const cv::Mat& labDist,
+                       int channel,
+                       const MaskSpans& spans)
+{
+  CV_Assert(labRef.type() == CV_32FC3);
+  CV_Assert(labDist.type() == CV_32FC3);
+  CV_Assert(labRef.size() == labDist.size());
+  CV_Assert(spans.size == labRef.size());
+  CV_Assert(channel >= 0 && channel < 3);
+
+  if (spans.empty())
+    return 0.0;
+
+  double sumSq = 0.0;
+  for (int y = 0; y < labRef.rows; ++y) {
+    const MaskSpan* s   = spans.row_begin(y);
+    const MaskSpan* end = spans.row_end(y);
+    if (s == end)
+      continue;
+    const float* r = labRef.ptr<float>(y) + channel;
+    const float* d = labDist.ptr<float>(y) + channel;
+    for (; s != end; ++s) {
+      for (int x = s->x0; x < s->x1; ++x) {
+        const double diff = static_cast<double>(r[3 * x]) - static_cast<double>(d[3 * x]);
+        sumSq += diff * diff;
+      }
+    }
+  }
+  return sumSq / static_cast<double>(spans.area);
+}
+
+std::vector<cv::Vec3d> lab_mse_by_label(const cv::Mat& labRef,
+                                        const cv::Mat& labDist,
+                                        const cv::Mat& labels,
+                                        int numLabels)
+{
+  CV_Assert(labRef.type() == CV_32FC3);
+  CV_Assert(labDist.type() == CV_32FC3);
+  CV_Assert(labRef.size() == labDist.size());
+  CV_Assert(labels.type() == CV_8U && labels.size() == labRef.size());
+  CV_Assert(numLabels > 0 && numLabels <= 256);
+
+  std::vector<cv::Vec3d> sums(static_cast<std::size_t>(numLabels), cv::Vec3d(0.0, 0.0, 0.0));
+  std::vector<std::size_t> counts(static_cast<std::size_t>(numLabels), 0);
+
+  for (int y = 0; y < labRef.rows; ++y) {
+    const float* r = labRef.ptr<float>(y);
+    const float* d = labDist.ptr<float>(y);
+    const uchar* l = labels.ptr<uchar>(y);
+    for (int x = 0; x < labRef.cols; ++x) {
+      const int lab = l[x];
+      if (lab >= numLabels)
+        continue;
+      const double dL = static_cast<double>(r[3 * x + 0]) - static_cast<double>(d[3 * x + 0]);
+      const double da = static_cast<double>(r[3 * x + 1]) - static_cast<double>(d[3 * x + 1]);
+      const double db = static_cast<double>(r[3 * x + 2]) - static_cast<double>(d[3 * x + 2]);
+      cv::Vec3d& s = sums[static_cast<std::size_t>(lab)];
+      s[0] += dL * dL;
+      s[1] += da * da;
+      s[2] += db * db;
+      ++counts[static_cast<std::size_t>(lab)];
+    }
+  }
+
+  for (int i = 0; i < numLabels; ++i) {
+    const std::size_t n = counts[static_cast<std::size_t>(i)];
+    if (n > 0)
+      sums[static_cast<std::size_t>(i)] *= 1.0 / static_cast<double>(n);
+  }
+  return sums;
+}
 }
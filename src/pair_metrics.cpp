@@ -0,0 +1,439 @@
+#include "iqalab/pair_metrics.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgproc.hpp>
+
+#include "iqalab/blur.hpp"
+#include "iqalab/mse.hpp"
+#include "iqalab/region_masks.hpp"
+#include "iqalab/utils/bit_mask.hpp"
+
+namespace iqa
+{
+
+namespace
+{
+
+// Dilation radii of the blur/sharpening masks per region class.
+constexpr int kBlurRadiusFlat   = 1;
+constexpr int kBlurRadiusMid    = 2;
+constexpr int kBlurRadiusDetail = 3;
+
+// Dilated mask of one region class, bit-packed: 1/8 of the CV_8U size,
+// counted by popcount, and masked means skip empty 64-pixel words.
+BitMask dilate_label_mask(const cv::Mat& labels, RegionClass cls, int r)
+{
+    const BitMask mask = BitMask::from_label(labels, static_cast<uchar>(cls));
+    if (r <= 0)
+        return mask;
+
+    const int k = 2 * r + 1;
+    return mask.dilated(cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(k, k)));
+}
+
+// Intermediates a metric depends on. Tasks producing them are added to
+// the graph only if some selected metric needs them.
+enum Need : unsigned
+{
+    kNeedRegions     = 1u << 0,   // segmentation of the reference
+    kNeedMaskFlat    = 1u << 1,   // dilated blur masks, one per class
+    kNeedMaskMid     = 1u << 2,
+    kNeedMaskDetail  = 1u << 3,
+    kNeedGradientsL  = 1u << 4,   // L gradient energy maps of both images
+    kNeedGradientsAb = 1u << 5,   // a,b gradient energy maps of both images
+    kNeedHalo        = 1u << 6,   // edge points and profiles on the detail mask
+    kNeedMseAll      = 1u << 7,
+    kNeedMseRegions  = 1u << 8
+};
+
+struct MetricDef
+{
+    const char* name;   // CSV column
+    unsigned needs;
+    double (*get)(const PairMetrics&);
+};
+
+constexpr unsigned kFlat   = kNeedRegions | kNeedMaskFlat;
+constexpr unsigned kMid    = kNeedRegions | kNeedMaskMid;
+constexpr unsigned kDetail = kNeedRegions | kNeedMaskDetail;
+constexpr unsigned kHalo   = kNeedRegions | kNeedHalo;
+constexpr unsigned kMseRegion = kNeedRegions | kNeedMseRegions;
+
+// The metric registry, in CSV order.
+const MetricDef kMetrics[] = {
+    {"n_region_flat",   kNeedRegions, [](const PairMetrics& m) { return m.n_region_flat; }},
+    {"n_region_mid",    kNeedRegions, [](const PairMetrics& m) { return m.n_region_mid; }},
+    {"n_region_detail", kNeedRegions, [](const PairMetrics& m) { return m.n_region_detail; }},
+
+    {"n_blur_flat",   kFlat,   [](const PairMetrics& m) { return m.n_blur_flat; }},
+    {"n_blur_mid",    kMid,    [](const PairMetrics& m) { return m.n_blur_mid; }},
+    {"n_blur_detail", kDetail, [](const PairMetrics& m) { return m.n_blur_detail; }},
+
+    {"blur_L_flat",   kFlat   | kNeedGradientsL, [](const PairMetrics& m) { return m.blur_L_flat; }},
+    {"blur_L_mid",    kMid    | kNeedGradientsL, [](const PairMetrics& m) { return m.blur_L_mid; }},
+    {"blur_L_detail", kDetail | kNeedGradientsL, [](const PairMetrics& m) { return m.blur_L_detail; }},
+
+    {"blur_ab_flat",   kFlat   | kNeedGradientsAb, [](const PairMetrics& m) { return m.blur_ab_flat; }},
+    {"blur_ab_mid",    kMid    | kNeedGradientsAb, [](const PairMetrics& m) { return m.blur_ab_mid; }},
+    {"blur_ab_detail", kDetail | kNeedGradientsAb, [](const PairMetrics& m) { return m.blur_ab_detail; }},
+
+    {"sharp_L_flat",   kFlat   | kNeedGradientsL, [](const PairMetrics& m) { return m.sharp_L_flat; }},
+    {"sharp_L_mid",    kMid    | kNeedGradientsL, [](const PairMetrics& m) { return m.sharp_L_mid; }},
+    {"sharp_L_detail", kDetail | kNeedGradientsL, [](const PairMetrics& m) { return m.sharp_L_detail; }},
+
+    {"sharp_ab_flat",   kFlat   | kNeedGradientsAb, [](const PairMetrics& m) { return m.sharp_ab_flat; }},
+    {"sharp_ab_mid",    kMid    | kNeedGradientsAb, [](const PairMetrics& m) { return m.sharp_ab_mid; }},
+    {"sharp_ab_detail", kDetail | kNeedGradientsAb, [](const PairMetrics& m) { return m.sharp_ab_detail; }},
+
+    {"halo_L_strength_detail",  kHalo, [](const PairMetrics& m) { return m.halo.halo_L_strength_detail; }},
+    {"halo_L_fraction_detail",  kHalo, [](const PairMetrics& m) { return m.halo.halo_L_fraction_detail; }},
+    {"halo_L_width_detail",     kHalo, [](const PairMetrics& m) { return m.halo.halo_L_width_detail; }},
+    {"halo_ab_strength_detail", kHalo, [](const PairMetrics& m) { return m.halo.halo_ab_strength_detail; }},
+    {"halo_ab_fraction_detail", kHalo, [](const PairMetrics& m) { return m.halo.halo_ab_fraction_detail; }},
+    {"halo_ab_width_detail",    kHalo, [](const PairMetrics& m) { return m.halo.halo_ab_width_detail; }},
+
+    {"mse_L_all",  kNeedMseAll, [](const PairMetrics& m) { return m.mse_L_all; }},
+    {"mse_ab_all", kNeedMseAll, [](const PairMetrics& m) { return m.mse_ab_all; }},
+
+    {"mse_L_flat",   kMseRegion, [](const PairMetrics& m) { return m.mse_L_flat; }},
+    {"mse_L_mid",    kMseRegion, [](const PairMetrics& m) { return m.mse_L_mid; }},
+    {"mse_L_detail", kMseRegion, [](const PairMetrics& m) { return m.mse_L_detail; }},
+
+    {"mse_ab_flat",   kMseRegion, [](const PairMetrics& m) { return m.mse_ab_flat; }},
+    {"mse_ab_mid",    kMseRegion, [](const PairMetrics& m) { return m.mse_ab_mid; }},
+    {"mse_ab_detail", kMseRegion, [](const PairMetrics& m) { return m.mse_ab_detail; }},
+};
+
+constexpr std::size_t kMetricCount = std::size(kMetrics);
+
+// Index of `name` in kMetrics; throws std::invalid_argument if unknown.
+std::size_t metric_index(const std::string& name)
+{
+    for (std::size_t i = 0; i < kMetricCount; ++i) {
+        if (name == kMetrics[i].name)
+            return i;
+    }
+    throw std::invalid_argument("Unknown metric: " + name);
+}
+
+unsigned selection_needs(const MetricSelection& selection)
+{
+    unsigned needs = 0;
+    for (std::size_t i = 0; i < kMetricCount; ++i) {
+        if (selection.contains(i))
+            needs |= kMetrics[i].needs;
+    }
+    return needs;
+}
+
+// Intermediates shared between the tasks of one pair.
+struct PairIntermediates
+{
+    RegionMasks regionMasks;
+    cv::Mat gradRefL, gradRefAb, gradDistL, gradDistAb;
+    BitMask blurMask[kRegionClassCount];
+};
+
+// Adds the tasks for the selected metrics of one pair to `graph`. All
+// references must stay valid until the graph has run.
+void build_pair_metrics_graph(utils::TaskGraph& graph,
+                              const cv::Mat& labRef,
+                              const cv::Mat& labDist,
+                              const RegionProvider& regions,
+                              const MetricSelection& selection,
+                              PairIntermediates& st,
+                              PairMetrics& m)
+{
+    using Id = utils::TaskGraph::Id;
+    const unsigned needs = selection_needs(selection);
+
+    // Region masks on reference (Lab).
+    Id regionsTask = 0;
+    if (needs & kNeedRegions) {
+        regionsTask = graph.add("regions", [&] {
+            st.regionMasks = regions.compute_regions(labRef);
+
+            const auto regionCounts = count_region_labels(st.regionMasks.labels);
+            m.n_region_flat   = static_cast<double>(regionCounts[0]);
+            m.n_region_mid    = static_cast<double>(regionCounts[1]);
+            m.n_region_detail = static_cast<double>(regionCounts[2]);
+        });
+    }
+
+    std::vector<Id> gradientsL, gradientsAb;
+    if (needs & kNeedGradientsL) {
+        gradientsL.push_back(graph.add("gradients_ref_L",   [&] { st.gradRefL  = blur::l_gradient_energy_map(labRef); }));
+        gradientsL.push_back(graph.add("gradients_dist_L",  [&] { st.gradDistL = blur::l_gradient_energy_map(labDist); }));
+    }
+    if (needs & kNeedGradientsAb) {
+        gradientsAb.push_back(graph.add("gradients_ref_ab",  [&] { st.gradRefAb  = blur::ab_gradient_energy_map(labRef); }));
+        gradientsAb.push_back(graph.add("gradients_dist_ab", [&] { st.gradDistAb = blur::ab_gradient_energy_map(labDist); }));
+    }
+
+    if (needs & kNeedMseAll) {
+        const bool wantL  = selection.contains("mse_L_all");
+        const bool wantAb = selection.contains("mse_ab_all");
+        graph.add("mse_all", [&, wantL, wantAb] {
+            if (wantL)
+                m.mse_L_all = mse::lab_channel_mse(labRef, labDist, 0);
+            if (wantAb)
+                m.mse_ab_all = mse::lab_channel_mse(labRef, labDist, 1) +
+                               mse::lab_channel_mse(labRef, labDist, 2);
+        });
+    }
+
+    // Dilated masks for blur/sharpening, then the values per mask from the
+    // shared energy maps.
+    struct PerClass
+    {
+        std::string name;
+        RegionClass cls;
+        int radius;
+        unsigned need;
+        double* nBlur;
+        double *blurL, *blurAb, *sharpL, *sharpAb;
+    };
+    const PerClass classes[] = {
+        {"flat",   RegionClass::Flat,   kBlurRadiusFlat,   kNeedMaskFlat,   &m.n_blur_flat,
+         &m.blur_L_flat,   &m.blur_ab_flat,   &m.sharp_L_flat,   &m.sharp_ab_flat},
+        {"mid",    RegionClass::Mid,    kBlurRadiusMid,    kNeedMaskMid,    &m.n_blur_mid,
+         &m.blur_L_mid,    &m.blur_ab_mid,    &m.sharp_L_mid,    &m.sharp_ab_mid},
+        {"detail", RegionClass::Detail, kBlurRadiusDetail, kNeedMaskDetail, &m.n_blur_detail,
+         &m.blur_L_detail, &m.blur_ab_detail, &m.sharp_L_detail, &m.sharp_ab_detail},
+    };
+
+    for (const PerClass& c : classes) {
+        if (!(needs & c.need))
+            continue;
+
+        const int k = static_cast<int>(c.cls);
+        const Id maskTask = graph.add("mask_" + c.name, [&st, c, k] {
+            st.blurMask[k] = dilate_label_mask(st.regionMasks.labels, c.cls, c.radius);
+            *c.nBlur = static_cast<double>(st.blurMask[k].count());
+        }, {regionsTask});
+
+        const bool wantL  = selection.contains("blur_L_" + c.name) ||
+                            selection.contains("sharp_L_" + c.name);
+        const bool wantAb = selection.contains("blur_ab_" + c.name) ||
+                            selection.contains("sharp_ab_" + c.name);
+        if (!wantL && !wantAb)
+            continue;
+
+        std::vector<Id> deps{maskTask};
+        if (wantL)
+            deps.insert(deps.end(), gradientsL.begin(), gradientsL.end());
+        if (wantAb)
+            deps.insert(deps.end(), gradientsAb.begin(), gradientsAb.end());
+
+        graph.add("blur_" + c.name, [&st, c, k, wantL, wantAb] {
+            const BitMask& mask = st.blurMask[k];
+            if (wantL) {
+                const double ref  = blur::mean_gradient_energy(st.gradRefL,  mask);
+                const double dist = blur::mean_gradient_energy(st.gradDistL, mask);
+                *c.blurL  = blur::relative_blur_from_energies(ref, dist);
+                *c.sharpL = blur::relative_sharp_from_energies(ref, dist);
+            }
+            if (wantAb) {
+                const double ref  = blur::mean_gradient_energy(st.gradRefAb,  mask);
+                const double dist = blur::mean_gradient_energy(st.gradDistAb, mask);
+                *c.blurAb  = blur::relative_blur_from_energies(ref, dist);
+                *c.sharpAb = blur::relative_sharp_from_energies(ref, dist);
+            }
+        }, std::move(deps));
+    }
+
+    if (needs & kNeedHalo) {
+        graph.add("halo", [&] {
+            m.halo = halo::compute_halo_metrics(labRef, labDist, st.regionMasks.detail());
+        }, {regionsTask});
+    }
+
+    // Per-region MSE (original regions), all classes in one pass.
+    if (needs & kNeedMseRegions) {
+        graph.add("mse_regions", [&] {
+            const std::vector<cv::Vec3d> regionMse =
+                mse::lab_mse_by_label(labRef, labDist, st.regionMasks.labels, kRegionClassCount);
+            const cv::Vec3d& mseFlat   = regionMse[static_cast<int>(RegionClass::Flat)];
+            const cv::Vec3d& mseMid    = regionMse[static_cast<int>(RegionClass::Mid)];
+            const cv::Vec3d& mseDetail = regionMse[static_cast<int>(RegionClass::Detail)];
+
+            m.mse_L_flat   = mseFlat[0];
+            m.mse_L_mid    = mseMid[0];
+            m.mse_L_detail = mseDetail[0];
+
+            m.mse_ab_flat   = mseFlat[1]   + mseFlat[2];
+            m.mse_ab_mid    = mseMid[1]    + mseMid[2];
+            m.mse_ab_detail = mseDetail[1] + mseDetail[2];
+        }, {regionsTask});
+    }
+}
+
+} // anonymous namespace
+
+const std::vector<std::string>& pair_metric_names()
+{
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> v;
+        for (const MetricDef& def : kMetrics)
+            v.emplace_back(def.name);
+        return v;
+    }();
+    return names;
+}
+
+MetricSelection::MetricSelection()
+    : m_selected(kMetricCount, true)
+{
+}
+
+MetricSelection::MetricSelection(const std::vector<std::string>& names)
+    : m_selected(kMetricCount, false)
+{
+    if (names.empty())
+        throw std::invalid_argument("No metrics selected");
+    for (const std::string& name : names)
+        m_selected[metric_index(name)] = true;
+}
+
+MetricSelection MetricSelection::parse(const std::string& list)
+{
+    std::vector<std::string> names;
+    std::size_t begin = 0;
+    while (begin <= list.size()) {
+        std::size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string name = list.substr(begin, end - begin);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (!name.empty())
+            names.push_back(std::move(name));
+        begin = end + 1;
+    }
+    return MetricSelection(names);
+}
+
+bool MetricSelection::contains(const std::string& name) const
+{
+    return m_selected[metric_index(name)];
+}
+
+std::vector<std::string> MetricSelection::names() const
+{
+    std::vector<std::string> v;
+    for (std::size_t i = 0; i < kMetricCount; ++i) {
+        if (m_selected[i])
+            v.emplace_back(kMetrics[i].name);
+    }
+    return v;
+}
+
+PairMetrics compute_pair_metrics(const cv::Mat& labRef,
+                                 const cv::Mat& labDist,
+                                 const RegionProvider& regions,
+                                 const MetricSelection& selection)
+{
+    CV_Assert(labRef.type() == CV_32FC3 && labDist.type() == CV_32FC3);
+    CV_Assert(labRef.size() == labDist.size());
+
+    PairMetrics m;
+    PairIntermediates st;
+    utils::TaskGraph graph;
+    build_pair_metrics_graph(graph, labRef, labDist, regions, selection, st, m);
+    graph.run();
+    return m;
+}
+
+PairMetrics compute_pair_metrics(const cv::Mat& labRef,
+                                 const cv::Mat& labDist,
+                                 const RegionProvider& regions,
+                                 utils::ThreadPool& pool,
+                                 PairMetricsTimings* timings,
+                                 const MetricSelection& selection)
+{
+    CV_Assert(labRef.type() == CV_32FC3 && labDist.type() == CV_32FC3);
+    CV_Assert(labRef.size() == labDist.size());
+
+    PairMetrics m;
+    PairIntermediates st;
+    utils::TaskGraph graph;
+    build_pair_metrics_graph(graph, labRef, labDist, regions, selection, st, m);
+    graph.run(pool);
+
+    if (timings) {
+        timings->tasks = graph.timings();
+        timings->wallMs = graph.wall_ms();
+    }
+    return m;
+}
+
+int pair_metrics_graph_width(const MetricSelection& selection)
+{
+    const unsigned needs = selection_needs(selection);
+    const auto has = [needs](unsigned need) { return (needs & need) ? 1 : 0; };
+
+    // Tasks without dependencies: regions, gradients, mse_all.
+    const int roots = has(kNeedRegions) + 2 * has(kNeedGradientsL) +
+                      2 * has(kNeedGradientsAb) + has(kNeedMseAll);
+    // Tasks waiting only for the regions, which may start while the other
+    // roots still run: the blur masks, halo and mse_regions.
+    const int afterRegions = has(kNeedMaskFlat) + has(kNeedMaskMid) + has(kNeedMaskDetail) +
+                             has(kNeedHalo) + has(kNeedMseRegions);
+    return std::max(1, std::max(roots, roots - has(kNeedRegions) + afterRegions));
+}
+
+void write_pair_metrics_timings(std::ostream& os, const PairMetricsTimings& timings)
+{
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+
+    std::size_t width = 0;
+    for (const utils::TaskGraph::Timing& t : timings.tasks)
+        width = std::max(width, t.name.size());
+
+    for (const utils::TaskGraph::Timing& t : timings.tasks) {
+        os << "  " << std::left << std::setw(static_cast<int>(width)) << t.name << std::right;
+        if (t.ran)
+            os << "  start " << std::setw(8) << t.startMs << " ms  took " << std::setw(8) << t.durationMs << " ms\n";
+        else
+            os << "  skipped\n";
+    }
+    os << "  " << std::left << std::setw(static_cast<int>(width)) << "wall" << std::right
+       << "  " << std::setw(29) << timings.wallMs << " ms\n";
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void write_pair_metrics_csv_header(std::ostream& os, const MetricSelection& selection)
+{
+    os << "ref_path,dist_path";
+    for (std::size_t i = 0; i < kMetricCount; ++i) {
+        if (selection.contains(i))
+            os << "," << kMetrics[i].name;
+    }
+    os << "\n";
+}
+
+void write_pair_metrics_csv_row(std::ostream& os,
+                                const std::filesystem::path& refPath,
+                                const std::filesystem::path& distPath,
+                                const PairMetrics& m,
+                                const MetricSelection& selection)
+{
+    os << refPath.string() << "," << distPath.string();
+    for (std::size_t i = 0; i < kMetricCount; ++i) {
+        if (selection.contains(i))
+            os << "," << kMetrics[i].get(m);
+    }
+    os << "\n";
+}
+
+} // namespace iqa
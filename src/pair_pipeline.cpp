@@ -0,0 +1,201 @@
+#include "iqalab/pair_pipeline.hpp"
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "iqalab/image_cache.hpp"
+#include "iqalab/image_type.hpp"
+#include "iqalab/mapped_image.hpp"
+
+namespace fs = std::filesystem;
+
+namespace iqa
+{
+
+PairPrefetcher::PairPrefetcher(std::vector<utils::ImagePair> pairs,
+                               const PairPrefetchOptions& options)
+    : m_pairs(std::move(pairs))
+    , m_options(options)
+{
+    CV_Assert(m_options.workers > 0);
+    CV_Assert(m_options.queueCapacity > 0);
+
+    const std::size_t n = std::min<std::size_t>(static_cast<std::size_t>(m_options.workers),
+                                                m_pairs.size());
+    m_workers.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+        m_workers.emplace_back(&PairPrefetcher::worker_loop, this);
+}
+
+PairPrefetcher::~PairPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_slotFree.notify_all();
+    for (std::thread& t : m_workers)
+        t.join();
+}
+
+bool PairPrefetcher::next(LoadedPair& out)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_nextDeliver >= m_pairs.size())
+        return false;
+
+    m_ready.wait(lock, [&] { return m_done.count(m_nextDeliver) != 0; });
+
+    auto it = m_done.find(m_nextDeliver);
+    out = std::move(it->second);
+    m_done.erase(it);
+    ++m_nextDeliver;
+
+    lock.unlock();
+    m_slotFree.notify_all();
+    return true;
+}
+
+void PairPrefetcher::worker_loop()
+{
+    for (;;) {
+        std::size_t index = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Claim only within the window ahead of the consumer, so the
+            // pair next() waits for is always claimed first.
+            m_slotFree.wait(lock, [&] {
+                return m_stopping || m_nextClaim >= m_pairs.size() ||
+                       m_nextClaim < m_nextDeliver + m_options.queueCapacity;
+            });
+            if (m_stopping || m_nextClaim >= m_pairs.size())
+                return;
+            index = m_nextClaim++;
+        }
+
+        LoadedPair loaded = decode(index);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.emplace(index, std::move(loaded));
+        }
+        m_ready.notify_one();
+    }
+}
+
+LoadedPair PairPrefetcher::decode(std::size_t index) const
+{
+    LoadedPair out;
+    out.index = index;
+    out.paths = m_pairs[index];
+
+    // Reject pairs of different size from the headers alone, before paying
+    // for two full decodes.
+    const ImageInfo refInfo  = probe_image(out.paths.refPath);
+    const ImageInfo distInfo = probe_image(out.paths.distPath);
+    if (probed_sizes_differ(refInfo, distInfo)) {
+        out.sizeMismatch = true;
+        return out;
+    }
+
+    const bool lab = m_options.format == PairImageFormat::Lab32;
+
+    // A decode failure only leaves the image empty; it must not escape the
+    // worker thread.
+    try {
+        if (m_options.refCache != nullptr) {
+            out.ref = lab ? m_options.refCache->load_lab32(out.paths.refPath)
+                          : m_options.refCache->load_bgr(out.paths.refPath);
+        } else {
+            out.ref = lab ? read_image_lab32(out.paths.refPath)
+                          : read_image_bgr(out.paths.refPath);
+        }
+
+        out.dist = lab ? read_image_lab32(out.paths.distPath)
+                       : read_image_bgr(out.paths.distPath);
+    } catch (const cv::Exception&) {
+        out.ref.release();
+        out.dist.release();
+    }
+
+    return out;
+}
+
+
+AsyncImageWriter::AsyncImageWriter(int workers, std::size_t queueCapacity)
+    : m_queueCapacity(queueCapacity)
+{
+    CV_Assert(workers > 0);
+    CV_Assert(queueCapacity > 0);
+
+    m_workers.reserve(static_cast<std::size_t>(workers));
+    for (int i = 0; i < workers; ++i)
+        m_workers.emplace_back(&AsyncImageWriter::worker_loop, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+    finish();
+}
+
+void AsyncImageWriter::write(fs::path path, cv::Mat image)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        CV_Assert(!m_closing);
+        m_notFull.wait(lock, [&] { return m_jobs.size() < m_queueCapacity; });
+        m_jobs.push_back(Job{std::move(path), std::move(image)});
+    }
+    m_notEmpty.notify_one();
+}
+
+std::vector<fs::path> AsyncImageWriter::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_notEmpty.notify_all();
+    for (std::thread& t : m_workers)
+        if (t.joinable())
+            t.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+void AsyncImageWriter::worker_loop()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notEmpty.wait(lock, [&] { return m_closing || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;   // closing and drained
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        m_notFull.notify_one();
+
+        bool ok = false;
+        try {
+            std::error_code ec;
+            if (job.path.has_parent_path())
+                fs::create_directories(job.path.parent_path(), ec);
+            ok = cv::imwrite(job.path.string(), job.image);
+        } catch (const cv::Exception&) {
+            ok = false;
+        }
+
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_failed.push_back(job.path);
+        }
+    }
+}
+
+} // namespace iqa
@@ -1,7 +1,9 @@
 #include <algorithm>
+#include <vector>
 #include <opencv2/core.hpp>
 
 #include <iqalab/region_blocks.hpp>
+#include <iqalab/region_block_grid.hpp>
 
 namespace iqa {
 namespace regions {
@@ -40,6 +42,76 @@ cv::Rect block_rect(const BlockGrid16& g, int blockIndex)
 }
 
 
+// Decide the class of a block from its per-class pixel counts.
+static BlockClass classify_block_counts(int flatCount,
+                                        int midCount,
+                                        int detailCount,
+                                        int area,
+                                        double minDominantFrac,
+                                        double strongPairFrac)
+{
+    if (area <= 0)
+        return BlockClass::None;
+
+    const double flatFrac   = static_cast<double>(flatCount)   / static_cast<double>(area);
+    const double midFrac    = static_cast<double>(midCount)    / static_cast<double>(area);
+    const double detailFrac = static_cast<double>(detailCount) / static_cast<double>(area);
+
+    // SPECIAL CASE:
+    // If both flat and detail have large fraction, and mid is small,
+    // classify the block as "mid".
+    //
+    // "Large part" is controlled by strongPairFrac (e.g. 0.3),
+    // "small mid" means midFrac < strongPairFrac.
+    if (flatFrac   >= strongPairFrac &&
+        detailFrac >= strongPairFrac &&
+        midFrac    <  strongPairFrac)
+    {
+        return BlockClass::Mid;
+    }
+
+    // Normal majority decision:
+    // choose the class with the highest count, but only if its
+    // fraction is at least minDominantFrac.
+    int maxCount = flatCount;
+    BlockClass maxClass = BlockClass::Flat;
+
+    if (midCount > maxCount) {
+        maxCount = midCount;
+        maxClass = BlockClass::Mid;
+    }
+    if (detailCount > maxCount) {
+        maxCount = detailCount;
+        maxClass = BlockClass::Detail;
+    }
+
+    const double maxFrac = static_cast<double>(maxCount) / static_cast<double>(area);
+
+    // Otherwise the block stays unclassified.
+    return (maxFrac >= minDominantFrac) ? maxClass : BlockClass::None;
+}
+
+// Write the chosen class into the block-sized region of the output masks.
+// Output masks are expected to be zero-initialized; None leaves them as is.
+static void fill_block(BlockRegionMasks& out, const cv::Rect& r, BlockClass cls)
+{
+    switch (cls) {
+    case BlockClass::Flat:
+        out.flat(r).setTo(uchar(255));
+        break;
+    case BlockClass::Mid:
+        out.mid(r).setTo(uchar(255));
+        break;
+    case BlockClass::Detail:
+        out.detail(r).setTo(uchar(255));
+        break;
+    case BlockClass::None:
+    default:
+        // Leave all zeros, do not override anything.
+        break;
+    }
+}
+
 BlockRegionMasks make_block_region_masks_from_pixel_masks(
     const BlockGrid16& grid,
     const cv::Mat1b& flatMask,
@@ -92,81 +164,93 @@ BlockRegionMasks make_block_region_masks_from_pixel_masks(
             }
         }
 
-        if (area <= 0)
-            continue;
+        fill_block(out, r,
+                   classify_block_counts(flatCount, midCount, detailCount, area,
+                                         minDominantFrac, strongPairFrac));
+    }
 
-        const double flatFrac   = static_cast<double>(flatCount)   / static_cast<double>(area);
-        const double midFrac    = static_cast<double>(midCount)    / static_cast<double>(area);
-        const double detailFrac = static_cast<double>(detailCount) / static_cast<double>(area);
-
-        // Decide which class the block belongs to.
-        enum class BlockClass { None, Flat, Mid, Detail };
-        BlockClass cls = BlockClass::None;
-
-        // SPECIAL CASE:
-        // If both flat and detail have large fraction, and mid is small,
-        // classify the block as "mid".
-        //
-        // "Large part" is controlled by strongPairFrac (e.g. 0.3),
-        // "small mid" means midFrac < strongPairFrac.
-        if (flatFrac   >= strongPairFrac &&
-            detailFrac >= strongPairFrac &&
-            midFrac    <  strongPairFrac)
-        {
-            cls = BlockClass::Mid;
-        }
-        else {
-            // Normal majority decision:
-            // choose the class with the highest count, but only if its
-            // fraction is at least minDominantFrac.
-            int maxCount = flatCount;
-            BlockClass maxClass = BlockClass::Flat;
-
-            if (midCount > maxCount) {
-                maxCount = midCount;
-                maxClass = BlockClass::Mid;
-            }
-            if (detailCount > maxCount) {
-                maxCount = detailCount;
-                maxClass = BlockClass::Detail;
-            }
+    return out;
+}
 
-            const double maxFrac = static_cast<double>(maxCount) / static_cast<double>(area);
+// Per-class counts of every block of a block row, one pass over its rows.
+// Templated over the grid type so 8/16/32/64 grids use shifts.
+template <class Grid>
+static void classify_blocks_impl(const Grid& grid,
+                                 const cv::Mat1b& labels,
+                                 double minDominantFrac,
+                                 double strongPairFrac,
+                                 cv::Mat1b& classes)
+{
+    // Per-class counters for the current block row: counts[bx * 3 + label].
+    std::vector<int> counts(static_cast<std::size_t>(grid.blocks_x()) * 3, 0);
+    const BlockRowSegments<Grid> segments = block_row_segments(grid);
 
-            if (maxFrac >= minDominantFrac) {
-                cls = maxClass;
-            } else {
-                cls = BlockClass::None;  // block stays unclassified
+    for (int by = 0; by < grid.blocks_y(); ++by) {
+        const cv::Range rows = block_row_span(grid, by);
+
+        std::fill(counts.begin(), counts.end(), 0);
+
+        // Stream the rows of this block row once, updating all blocks.
+        for (int y = rows.start; y < rows.end; ++y) {
+            const uchar* lRow = labels.ptr<uchar>(y);
+            for (const BlockRowSegment& seg : segments) {
+                int* c = counts.data() + static_cast<std::size_t>(seg.bx) * 3;
+                for (int x = seg.x0; x < seg.x1; ++x) {
+                    const uchar l = lRow[x];
+                    if (l < 3)
+                        ++c[l];
+                }
             }
         }
 
-        // Write the chosen class into block-sized region in the output masks.
-        cv::Mat1b flatROI   = out.flat(r);
-        cv::Mat1b midROI    = out.mid(r);
-        cv::Mat1b detailROI = out.detail(r);
-
-        switch (cls) {
-        case BlockClass::Flat:
-            flatROI.setTo(uchar(255));
-            midROI.setTo(uchar(0));
-            detailROI.setTo(uchar(0));
-            break;
-        case BlockClass::Mid:
-            flatROI.setTo(uchar(0));
-            midROI.setTo(uchar(255));
-            detailROI.setTo(uchar(0));
-            break;
-        case BlockClass::Detail:
-            flatROI.setTo(uchar(0));
-            midROI.setTo(uchar(0));
-            detailROI.setTo(uchar(255));
-            break;
-        case BlockClass::None:
-        default:
-            // Leave all zeros, do not override anything.
-            // (If you prefer to force exactly-one-class everywhere,
-            //  you can choose a default here.)
-            break;
+        uchar* outRow = classes.ptr<uchar>(by);
+        for (const BlockRowSegment& seg : segments) {
+            const int area = (seg.x1 - seg.x0) * (rows.end - rows.start);
+            const int* c = counts.data() + static_cast<std::size_t>(seg.bx) * 3;
+            outRow[seg.bx] = static_cast<uchar>(
+                classify_block_counts(c[0], c[1], c[2], area,
+                                      minDominantFrac, strongPairFrac));
+        }
+    }
+}
+
+cv::Mat1b classify_blocks_from_labels(
+    const BlockGrid16& grid,
+    const cv::Mat1b& labels,
+    double minDominantFrac,
+    double strongPairFrac
+)
+{
+    CV_Assert(labels.size() == grid.imageSize);
+    CV_Assert(labels.type() == CV_8UC1);
+
+    cv::Mat1b classes(grid.blocksY, grid.blocksX, static_cast<uchar>(BlockClass::None));
+
+    dispatch_block_grid(grid, [&](const auto& g)
+    {
+        classify_blocks_impl(g, labels, minDominantFrac, strongPairFrac, classes);
+    });
+
+    return classes;
+}
+
+BlockRegionMasks expand_block_classes(const BlockGrid16& grid,
+                                      const cv::Mat1b& classes)
+{
+    CV_Assert(classes.rows == grid.blocksY && classes.cols == grid.blocksX);
+
+    BlockRegionMasks out;
+    out.flat   = cv::Mat1b(grid.imageSize, uchar(0));
+    out.mid    = cv::Mat1b(grid.imageSize, uchar(0));
+    out.detail = cv::Mat1b(grid.imageSize, uchar(0));
+
+    for (int by = 0; by < grid.blocksY; ++by) {
+        const uchar* cRow = classes.ptr<uchar>(by);
+        for (int bx = 0; bx < grid.blocksX; ++bx) {
+            const cv::Rect r = block_rect(grid, by * grid.blocksX + bx);
+            if (r.width <= 0 || r.height <= 0)
+                continue;
+            fill_block(out, r, static_cast<BlockClass>(cRow[bx]));
         }
     }
 
@@ -0,0 +1,254 @@
+#include "iqalab/region_cache.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+#include "iqalab/utils/content_hash.hpp"
+#include "iqalab/utils/mapped_file.hpp"
+
+namespace iqa
+{
+
+namespace
+{
+
+constexpr char kCacheMagic[4] = { 'I', 'Q', 'R', 'M' };
+constexpr std::uint32_t kCacheVersion = 1;
+constexpr std::uint32_t kFlagGradMag = 1u;
+
+// On-disk header; all fields are naturally aligned, sizeof == 32.
+struct CacheHeader
+{
+    char          magic[4];
+    std::uint32_t version;
+    std::uint64_t key;
+    std::int32_t  rows;
+    std::int32_t  cols;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(CacheHeader) == 32, "CacheHeader layout");
+
+// Offset of the gradMag plane: labels padded to 4 bytes.
+std::size_t grad_offset(int rows, int cols)
+{
+    const std::size_t labelsEnd = sizeof(CacheHeader) +
+                                  static_cast<std::size_t>(rows) * static_cast<std::size_t>(cols);
+    return (labelsEnd + 3) & ~static_cast<std::size_t>(3);
+}
+
+} // anonymous namespace
+
+CachedRegionProvider::CachedRegionProvider(std::shared_ptr<const RegionProvider> inner,
+                                           std::filesystem::path cacheDir,
+                                           std::size_t memoryEntries)
+    : m_inner(std::move(inner))
+    , m_cacheDir(std::move(cacheDir))
+    , m_memoryEntries(memoryEntries)
+    , m_providerSeed(0)
+{
+    CV_Assert(m_inner != nullptr);
+
+    std::filesystem::create_directories(m_cacheDir);
+
+    std::string id = m_inner->name();
+    id += '\0';
+    id += m_inner->parameters();
+    m_providerSeed = utils::hash_string(id, kCacheVersion);
+}
+
+std::uint64_t CachedRegionProvider::cache_key(const cv::Mat& labRef) const
+{
+    return utils::hash_mat(labRef, m_providerSeed);
+}
+
+std::filesystem::path CachedRegionProvider::file_path(std::uint64_t key) const
+{
+    return m_cacheDir / (utils::hash_to_hex(key) + ".iqrm");
+}
+
+RegionMasks CachedRegionProvider::compute_regions(const cv::Mat& labRef) const
+{
+    CV_Assert(labRef.type() == CV_32FC3);
+    CV_Assert(!labRef.empty());
+
+    const std::uint64_t key = cache_key(labRef);
+
+    RegionMasks masks;
+    if (lookup_memory(key, masks))
+        return masks;
+
+    if (load_file(key, labRef.size(), masks)) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.diskHits;
+        }
+        insert_memory(key, masks);
+        return masks;
+    }
+
+    masks = m_inner->compute_regions(labRef);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.misses;
+    }
+    store_file(key, masks);
+    insert_memory(key, masks);
+    return masks;
+}
+
+CachedRegionProvider::Stats CachedRegionProvider::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+bool CachedRegionProvider::lookup_memory(std::uint64_t key, RegionMasks& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_lruIndex.find(key);
+    if (it == m_lruIndex.end())
+        return false;
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    out = it->second->second;
+    ++m_stats.memoryHits;
+    return true;
+}
+
+void CachedRegionProvider::insert_memory(std::uint64_t key, const RegionMasks& masks) const
+{
+    if (m_memoryEntries == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_lruIndex.find(key);
+    if (it != m_lruIndex.end()) {
+        // Another thread got here first.
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return;
+    }
+
+    m_lru.emplace_front(key, masks);
+    m_lruIndex[key] = m_lru.begin();
+
+    while (m_lru.size() > m_memoryEntries) {
+        m_lruIndex.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+bool CachedRegionProvider::load_file(std::uint64_t key, const cv::Size& size,
+                                     RegionMasks& out) const
+{
+    const std::filesystem::path path = file_path(key);
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec))
+        return false;
+
+    utils::MappedFile file;
+    try {
+        file = utils::MappedFile(path);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    if (file.size() < sizeof(CacheHeader))
+        return false;
+
+    CacheHeader h;
+    std::memcpy(&h, file.data(), sizeof(h));
+    if (std::memcmp(h.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+        h.version != kCacheVersion || h.key != key ||
+        h.rows != size.height || h.cols != size.width)
+        return false;
+
+    const bool hasGrad = (h.flags & kFlagGradMag) != 0;
+    const std::size_t pixels = static_cast<std::size_t>(h.rows) * static_cast<std::size_t>(h.cols);
+    const std::size_t expected = hasGrad
+        ? grad_offset(h.rows, h.cols) + pixels * sizeof(float)
+        : sizeof(CacheHeader) + pixels;
+    if (file.size() != expected)
+        return false;
+
+    // Wrap the mapped planes and copy them out; the mapping is released
+    // when `file` goes out of scope.
+    unsigned char* base = const_cast<unsigned char*>(file.data());
+    cv::Mat(h.rows, h.cols, CV_8U, base + sizeof(CacheHeader)).copyTo(out.labels);
+    if (hasGrad)
+        cv::Mat(h.rows, h.cols, CV_32F, base + grad_offset(h.rows, h.cols)).copyTo(out.gradMag);
+    else
+        out.gradMag.release();
+
+    return true;
+}
+
+void CachedRegionProvider::store_file(std::uint64_t key, const RegionMasks& masks) const
+{
+    CV_Assert(masks.labels.type() == CV_8U);
+
+    const bool hasGrad = !masks.gradMag.empty();
+    CV_Assert(!hasGrad || (masks.gradMag.type() == CV_32F &&
+                           masks.gradMag.size() == masks.labels.size()));
+
+    CacheHeader h;
+    std::memcpy(h.magic, kCacheMagic, sizeof(kCacheMagic));
+    h.version = kCacheVersion;
+    h.key = key;
+    h.rows = masks.labels.rows;
+    h.cols = masks.labels.cols;
+    h.flags = hasGrad ? kFlagGradMag : 0u;
+    h.reserved = 0;
+
+    const std::filesystem::path path = file_path(key);
+
+    // Unique temporary name per writer, renamed into place when complete.
+    const std::size_t salt =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+        static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::filesystem::path tmp = path;
+    tmp += ".tmp" + utils::hash_to_hex(salt);
+
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os)
+            return;
+
+        os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+        const std::size_t labelRow = static_cast<std::size_t>(h.cols);
+        for (int y = 0; y < h.rows; ++y)
+            os.write(reinterpret_cast<const char*>(masks.labels.ptr<uchar>(y)),
+                     static_cast<std::streamsize>(labelRow));
+
+        if (hasGrad) {
+            const std::size_t pad = grad_offset(h.rows, h.cols) -
+                                    (sizeof(CacheHeader) + labelRow * static_cast<std::size_t>(h.rows));
+            const char zeros[4] = { 0, 0, 0, 0 };
+            os.write(zeros, static_cast<std::streamsize>(pad));
+
+            const std::size_t gradRow = labelRow * sizeof(float);
+            for (int y = 0; y < h.rows; ++y)
+                os.write(reinterpret_cast<const char*>(masks.gradMag.ptr<float>(y)),
+                         static_cast<std::streamsize>(gradRow));
+        }
+
+        if (!os) {
+            os.close();
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec)
+        std::filesystem::remove(tmp, ec);
+}
+
+} // namespace iqa
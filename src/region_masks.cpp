@@ -8,6 +8,67 @@
 
 namespace iqa {
 
+cv::Mat RegionMasks::mask(RegionClass c) const
+{
+    CV_Assert(labels.type() == CV_8U);
+
+    cv::Mat m;
+    cv::compare(labels, cv::Scalar(static_cast<double>(c)), m, cv::CMP_EQ);
+    return m;
+}
+
+std::array<std::size_t, kRegionClassCount> count_region_labels(const cv::Mat& labels)
+{
+    CV_Assert(labels.type() == CV_8U);
+
+    std::array<std::size_t, kRegionClassCount> counts{};
+    for (int y = 0; y < labels.rows; ++y) {
+        const uchar* lrow = labels.ptr<uchar>(y);
+        for (int x = 0; x < labels.cols; ++x) {
+            const uchar l = lrow[x];
+            if (l < kRegionClassCount)
+                ++counts[l];
+        }
+    }
+    return counts;
+}
+
+RegionLabelAgreement compare_region_labels(const cv::Mat& a, const cv::Mat& b)
+{
+    CV_Assert(a.type() == CV_8U && b.type() == CV_8U);
+    CV_Assert(a.size() == b.size());
+
+    RegionLabelAgreement r;
+    std::size_t total = 0;
+    for (int y = 0; y < a.rows; ++y) {
+        const uchar* arow = a.ptr<uchar>(y);
+        const uchar* brow = b.ptr<uchar>(y);
+        for (int x = 0; x < a.cols; ++x) {
+            const uchar la = arow[x];
+            const uchar lb = brow[x];
+            if (la < kRegionClassCount && lb < kRegionClassCount) {
+                ++r.confusion[la][lb];
+                ++total;
+            }
+        }
+    }
+
+    std::size_t same = 0;
+    for (int c = 0; c < kRegionClassCount; ++c) {
+        std::size_t inA = 0, inB = 0;
+        for (int k = 0; k < kRegionClassCount; ++k) {
+            inA += r.confusion[c][k];
+            inB += r.confusion[k][c];
+        }
+        const std::size_t both = r.confusion[c][c];
+        const std::size_t uni  = inA + inB - both;
+        r.iou[c] = (uni > 0) ? static_cast<double>(both) / static_cast<double>(uni) : 1.0;
+        same += both;
+    }
+    r.agreement = (total > 0) ? static_cast<double>(same) / static_cast<double>(total) : 1.0;
+    return r;
+}
+
 static float percentile_from_vector(std::vector<float>& vals, float p)
 {
     if (vals.empty()) return 0.0f;
@@ -97,15 +158,15 @@ RegionMasks compute_region_masks32(const cv::Mat& refL,
     float thrFlat   = percentile_from_vector(vals, flatPercentile);
     float thrDetail = percentile_from_vector(vals, detailPercentile);
 
-    masks.flat.create(refL.size(), CV_8U);
-    masks.detail.create(refL.size(), CV_8U);
-    masks.mid.create(refL.size(), CV_8U);
+    masks.labels.create(refL.size(), CV_8U);
+
+    const auto flatLabel   = static_cast<uchar>(RegionClass::Flat);
+    const auto midLabel    = static_cast<uchar>(RegionClass::Mid);
+    const auto detailLabel = static_cast<uchar>(RegionClass::Detail);
 
     for (int y = 0; y < refL.rows; ++y) {
         const float* grow = masks.gradMag.ptr<float>(y);
-        auto* frow = masks.flat.ptr<uchar>(y);
-        auto* drow = masks.detail.ptr<uchar>(y);
-        auto* mrow = masks.mid.ptr<uchar>(y);
+        auto* lrow = masks.labels.ptr<uchar>(y);
 
         for (int x = 0; x < refL.cols; ++x) {
             float g = grow[x];
@@ -113,15 +174,38 @@ RegionMasks compute_region_masks32(const cv::Mat& refL,
             bool isFlat   = (g <= thrFlat);
             bool isDetail = (g >= thrDetail);
 
-            frow[x] = isFlat   ? 255 : 0;
-            drow[x] = isDetail ? 255 : 0;
-            mrow[x] = (!isFlat && !isDetail) ? 255 : 0;
+            lrow[x] = isFlat ? flatLabel : (isDetail ? detailLabel : midLabel);
         }
     }
 
     return masks;
 }
 
+// Mean and interpolated 95th percentile of a sample (sorted in place).
+static void mean_p95_stats(std::vector<float>& vals,
+                           double& mean,
+                           double& p95,
+                           int& count)
+{
+    count = static_cast<int>(vals.size());
+    if (vals.empty()) {
+        mean = 0.0;
+        p95  = 0.0;
+        return;
+    }
+
+    double sum = 0.0;
+    for (float v : vals) sum += v;
+    mean = sum / static_cast<double>(vals.size());
+
+    std::sort(vals.begin(), vals.end());
+    float idx = 0.95f * static_cast<float>(vals.size() - 1);
+    auto i  = static_cast<size_t>(idx);
+    size_t j  = std::min(i + 1, vals.size() - 1);
+    float t   = idx - static_cast<float>(i);
+    p95 = (1.0f - t) * vals[i] + t * vals[j];
+}
+
 static void masked_absdiff_stats(const cv::Mat& a,
                                  const cv::Mat& b,
                                  const cv::Mat& mask,
@@ -150,23 +234,34 @@ static void masked_absdiff_stats(const cv::Mat& a,
         }
     }
 
-    count = static_cast<int>(diffs.size());
-    if (diffs.empty()) {
-        meanAbsDiff = 0.0;
-        p95AbsDiff  = 0.0;
-        return;
-    }
+    mean_p95_stats(diffs, meanAbsDiff, p95AbsDiff, count);
+}
 
-    double sum = 0.0;
-    for (float v : diffs) sum += v;
-    meanAbsDiff = sum / static_cast<double>(diffs.size());
+static void masked_absdiff_stats(const cv::Mat& a,
+                                 const cv::Mat& b,
+                                 const MaskSpans& spans,
+                                 double& meanAbsDiff,
+                                 double& p95AbsDiff,
+                                 int& count)
+{
+    CV_Assert(a.type() == CV_32F);
+    CV_Assert(b.type() == CV_32F);
+    CV_Assert(a.size() == b.size());
+    CV_Assert(a.size() == spans.size);
 
-    std::sort(diffs.begin(), diffs.end());
-    float idx = 0.95f * static_cast<float>(diffs.size() - 1);
-    auto i  = static_cast<size_t>(idx);
-    size_t j  = std::min(i + 1, diffs.size() - 1);
-    float t   = idx - static_cast<float>(i);
-    p95AbsDiff = (1.0f - t) * diffs[i] + t * diffs[j];
+    std::vector<float> diffs;
+    diffs.reserve(spans.area);
+
+    for (int y = 0; y < a.rows; ++y) {
+        const auto* ar = a.ptr<float>(y);
+        const auto* br = b.ptr<float>(y);
+        for (const MaskSpan* s = spans.row_begin(y); s != spans.row_end(y); ++s) {
+            for (int x = s->x0; x < s->x1; ++x)
+                diffs.push_back(std::fabs(ar[x] - br[x]));
+        }
+    }
+
+    mean_p95_stats(diffs, meanAbsDiff, p95AbsDiff, count);
 }
 
 ImpulseScore score_impulses(const cv::Mat& refL,
@@ -178,7 +273,21 @@ ImpulseScore score_impulses(const cv::Mat& refL,
     CV_Assert(refL.size() == distL.size());
 
     ImpulseScore s{};
-    masked_absdiff_stats(refL, distL, masks.flat,
+    masked_absdiff_stats(refL, distL, masks.flat(),
+                         s.meanOnFlat, s.p95OnFlat, s.countFlat);
+    return s;
+}
+
+ImpulseScore score_impulses(const cv::Mat& refL,
+                            const cv::Mat& distL,
+                            const MaskSpans& spans)
+{
+    CV_Assert(refL.type() == CV_32F);
+    CV_Assert(distL.type() == CV_32F);
+    CV_Assert(refL.size() == distL.size());
+
+    ImpulseScore s{};
+    masked_absdiff_stats(refL, distL, spans,
                          s.meanOnFlat, s.p95OnFlat, s.countFlat);
     return s;
 }
@@ -248,7 +357,7 @@ BlurScore score_blur(const cv::Mat& refL,
     cv::GaussianBlur(magD, magD, cv::Size(3, 3), 0.8);
 
     BlurScore s{};
-    masked_gradloss_stats(masks.gradMag, magD, masks.detail,
+    masked_gradloss_stats(masks.gradMag, magD, masks.detail(),
                           s.meanLossOnDetail, s.p95LossOnDetail, s.countDetail);
     return s;
 }
@@ -1,10 +1,17 @@
 #include "iqalab/region_provider.hpp"
 
-#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
 
 #include <opencv2/core/mat.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
 
+#include "iqalab/region_block_grid.hpp"
 #include "iqalab/region_masks.hpp"
+#include "iqalab/superpixels.hpp"
 
 namespace iqa
 {
@@ -23,6 +30,13 @@ PixelwiseRegionProvider::PixelwiseRegionProvider(float flatPercentile,
     // into region_masks.cpp once it is refactored to accept parameters.
 }
 
+std::string PixelwiseRegionProvider::parameters() const
+{
+    std::ostringstream os;
+    os << "flat=" << m_flatPercentile << ",detail=" << m_detailPercentile;
+    return os.str();
+}
+
 RegionMasks PixelwiseRegionProvider::compute_regions(const cv::Mat& labRef) const
 {
     // Delegates to the current percentile-based implementation.
@@ -35,21 +49,128 @@ RegionMasks PixelwiseRegionProvider::compute_regions(const cv::Mat& labRef) cons
 // BlockRegionProvider
 // ------------------------------------------------------------
 
-BlockRegionProvider::BlockRegionProvider(int blockSize)
+BlockRegionProvider::BlockRegionProvider(int blockSize,
+                                         float flatPercentile,
+                                         float detailPercentile)
     : m_blockSize(blockSize)
+    , m_flatPercentile(flatPercentile)
+    , m_detailPercentile(detailPercentile)
+{
+    CV_Assert(blockSize > 0);
+}
+
+std::string BlockRegionProvider::parameters() const
 {
+    std::ostringstream os;
+    os << "block=" << m_blockSize
+       << ",flat=" << m_flatPercentile << ",detail=" << m_detailPercentile;
+    return os.str();
+}
+
+cv::Mat1b BlockRegionProvider::compute_block_classes(const cv::Mat& labRef,
+                                                     regions::BlockGrid16& grid,
+                                                     cv::Mat* gradMag) const
+{
+    CV_Assert(labRef.type() == CV_32FC3);
+    CV_Assert(!labRef.empty());
+
+    cv::Mat L;
+    cv::extractChannel(labRef, L, 0);
+
+    // Same gradient operator as the pixelwise provider.
+    cv::Mat gx, gy;
+    cv::Sobel(L, gx, CV_32F, 1, 0, 3);
+    cv::Sobel(L, gy, CV_32F, 0, 1, 3);
+
+    if (gradMag != nullptr)
+    {
+        cv::Mat mag;
+        cv::magnitude(gx, gy, mag);
+        cv::GaussianBlur(mag, *gradMag, cv::Size(3, 3), 0.8);
+    }
+
+    cv::Mat g2 = gx.mul(gx) + gy.mul(gy);
+
+    // Integral image of |grad L|^2: any block sum in O(1).
+    cv::Mat sum;
+    cv::integral(g2, sum, CV_64F);
+
+    grid = regions::make_block16_grid(labRef.size(), m_blockSize);
+
+    const int totalBlocks = grid.blocksX * grid.blocksY;
+    std::vector<float> energy(static_cast<std::size_t>(totalBlocks));
+
+    for (int by = 0; by < grid.blocksY; ++by)
+    {
+        const int y0 = by * grid.blockSize;
+        const int y1 = std::min(y0 + grid.blockSize, labRef.rows);
+        const double* s0 = sum.ptr<double>(y0);
+        const double* s1 = sum.ptr<double>(y1);
+
+        for (int bx = 0; bx < grid.blocksX; ++bx)
+        {
+            const int x0 = bx * grid.blockSize;
+            const int x1 = std::min(x0 + grid.blockSize, labRef.cols);
+            const double blockSum = s1[x1] - s0[x1] - s1[x0] + s0[x0];
+            const double area = static_cast<double>((x1 - x0) * (y1 - y0));
+            energy[static_cast<std::size_t>(by * grid.blocksX + bx)] =
+                static_cast<float>(blockSum / area);
+        }
+    }
+
+    // Block-level percentiles.
+    std::vector<float> sorted = energy;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](float p)
+    {
+        const float idx = std::clamp(p, 0.0f, 1.0f) * static_cast<float>(sorted.size() - 1);
+        const auto i = static_cast<std::size_t>(idx);
+        const std::size_t j = std::min(i + 1, sorted.size() - 1);
+        const float t = idx - static_cast<float>(i);
+        return (1.0f - t) * sorted[i] + t * sorted[j];
+    };
+    const float thrFlat   = percentile(m_flatPercentile);
+    const float thrDetail = percentile(m_detailPercentile);
+
+    cv::Mat1b classes(grid.blocksY, grid.blocksX);
+    for (int by = 0; by < grid.blocksY; ++by)
+    {
+        uchar* cRow = classes.ptr<uchar>(by);
+        for (int bx = 0; bx < grid.blocksX; ++bx)
+        {
+            const float e = energy[static_cast<std::size_t>(by * grid.blocksX + bx)];
+            regions::BlockClass cls = regions::BlockClass::Mid;
+            if (e <= thrFlat)
+                cls = regions::BlockClass::Flat;
+            else if (e >= thrDetail)
+                cls = regions::BlockClass::Detail;
+            cRow[bx] = static_cast<uchar>(cls);
+        }
+    }
+
+    return classes;
 }
 
 RegionMasks BlockRegionProvider::compute_regions(const cv::Mat& labRef) const
 {
-    (void)labRef;
-    // TODO: Implement block-based segmentation (e.g. 16x16 grid) using
-    // block-level gradient statistics in L channel.
-    //
-    // For now this provider is a stub to make the RegionProvider abstraction
-    // explicit without changing behaviour.
-    throw std::logic_error(
-        "BlockRegionProvider::compute_regions is not implemented yet");
+    RegionMasks masks;
+    regions::BlockGrid16 grid;
+    cv::Mat1b classes = compute_block_classes(labRef, grid, &masks.gradMag);
+
+    // Expand block classes into the pixel label map, one row at a time.
+    masks.labels.create(labRef.size(), CV_8U);
+    regions::dispatch_block_grid(grid, [&](const auto& g)
+    {
+        for (int y = 0; y < labRef.rows; ++y)
+        {
+            const uchar* cRow = classes.ptr<uchar>(g.block_y(y));
+            uchar* lRow = masks.labels.ptr<uchar>(y);
+            for (const regions::BlockRowSegment& seg : regions::block_row_segments(g))
+                std::fill(lRow + seg.x0, lRow + seg.x1, cRow[seg.bx]);
+        }
+    });
+
+    return masks;
 }
 
 
@@ -57,23 +178,395 @@ RegionMasks BlockRegionProvider::compute_regions(const cv::Mat& labRef) const
 // ------------------------------------------------------------
 
 SuperpixelRegionProvider::SuperpixelRegionProvider(int   desiredSuperpixels,
-                                                   float compactness)
+                                                   float compactness,
+                                                   float flatPercentile,
+                                                   float detailPercentile)
     : m_desiredSuperpixels(desiredSuperpixels)
     , m_compactness(compactness)
+    , m_flatPercentile(flatPercentile)
+    , m_detailPercentile(detailPercentile)
+{
+    CV_Assert(desiredSuperpixels > 0);
+}
+
+std::string SuperpixelRegionProvider::parameters() const
 {
+    std::ostringstream os;
+    os << "superpixels=" << m_desiredSuperpixels << ",compactness=" << m_compactness
+       << ",flat=" << m_flatPercentile << ",detail=" << m_detailPercentile;
+    return os.str();
 }
 
 RegionMasks SuperpixelRegionProvider::compute_regions(const cv::Mat& labRef) const
 {
-    (void)labRef;
-    // TODO: Implement superpixel-based segmentation (e.g. SLIC in Lab space)
-    // and classify superpixels into flat/mid/detail using region-level
-    // gradient/texture statistics.
-    //
-    // This stub makes the RegionProvider API ready while keeping the current
-    // behaviour unchanged in existing tools.
-    throw std::logic_error(
-        "SuperpixelRegionProvider::compute_regions is not implemented yet");
+    CV_Assert(labRef.type() == CV_32FC3);
+    CV_Assert(!labRef.empty());
+
+    RegionMasks masks;
+
+    // Pixel gradient magnitude, same operator as the pixelwise provider.
+    cv::Mat L;
+    cv::extractChannel(labRef, L, 0);
+    cv::Mat gx, gy, mag;
+    cv::Sobel(L, gx, CV_32F, 1, 0, 3);
+    cv::Sobel(L, gy, CV_32F, 0, 1, 3);
+    cv::magnitude(gx, gy, mag);
+    cv::GaussianBlur(mag, masks.gradMag, cv::Size(3, 3), 0.8);
+
+    // Superpixels; per-superpixel mean |grad| is gathered in the final
+    // assignment pass.
+    const regions::SuperpixelSegmentation seg =
+        regions::slic_superpixels(labRef, m_desiredSuperpixels, m_compactness,
+                                  masks.gradMag);
+
+    // Pixel-weighted percentiles of superpixel gradient means, so that
+    // roughly flatPercentile of the pixels end up flat (as for pixelwise).
+    std::vector<int> order(static_cast<std::size_t>(seg.count));
+    for (int k = 0; k < seg.count; ++k)
+        order[static_cast<std::size_t>(k)] = k;
+    std::sort(order.begin(), order.end(), [&seg](int p, int q)
+    {
+        return seg.meanGradient[static_cast<std::size_t>(p)] <
+               seg.meanGradient[static_cast<std::size_t>(q)];
+    });
+
+    const double totalPixels = static_cast<double>(labRef.total());
+    auto weighted_percentile = [&](float p) -> double
+    {
+        const double target = std::clamp(static_cast<double>(p), 0.0, 1.0) * totalPixels;
+        double cum = 0.0;
+        for (int k : order)
+        {
+            cum += seg.area[static_cast<std::size_t>(k)];
+            if (cum >= target)
+                return seg.meanGradient[static_cast<std::size_t>(k)];
+        }
+        return order.empty() ? 0.0 : seg.meanGradient[static_cast<std::size_t>(order.back())];
+    };
+    const double thrFlat   = weighted_percentile(m_flatPercentile);
+    const double thrDetail = weighted_percentile(m_detailPercentile);
+
+    std::vector<uchar> cls(static_cast<std::size_t>(seg.count));
+    for (int k = 0; k < seg.count; ++k)
+    {
+        const double g = seg.meanGradient[static_cast<std::size_t>(k)];
+        RegionClass c = RegionClass::Mid;
+        if (g <= thrFlat)
+            c = RegionClass::Flat;
+        else if (g >= thrDetail)
+            c = RegionClass::Detail;
+        cls[static_cast<std::size_t>(k)] = static_cast<uchar>(c);
+    }
+
+    masks.labels.create(labRef.size(), CV_8U);
+    for (int y = 0; y < labRef.rows; ++y)
+    {
+        const int* sRow = seg.labels.ptr<int>(y);
+        uchar* lRow = masks.labels.ptr<uchar>(y);
+        for (int x = 0; x < labRef.cols; ++x)
+            lRow[x] = cls[static_cast<std::size_t>(sRow[x])];
+    }
+
+    return masks;
+}
+
+
+// MultiResolutionRegionProvider
+// ------------------------------------------------------------
+
+namespace
+{
+
+// Refinement works on tiles of kRefineTileCells x kRefineTileCells low-res
+// pixels, so only small full-resolution gradient planes are ever allocated.
+constexpr int kRefineTileCells = 32;
+
+// Upper bound on pixels sampled for the full-resolution thresholds.
+constexpr std::size_t kMaxThresholdSamples = std::size_t(1) << 20;
+
+inline uchar classify_grad(float g, float thrFlat, float thrDetail)
+{
+    if (g <= thrFlat)
+        return static_cast<uchar>(RegionClass::Flat);
+    if (g >= thrDetail)
+        return static_cast<uchar>(RegionClass::Detail);
+    return static_cast<uchar>(RegionClass::Mid);
+}
+
+// Interpolated percentile (same definition as the pixelwise segmentation),
+// using selection instead of a full sort. Reorders vals.
+float select_percentile(std::vector<float>& vals, float p)
+{
+    if (vals.empty())
+        return 0.0f;
+
+    const float idx = std::clamp(p, 0.0f, 1.0f) * static_cast<float>(vals.size() - 1);
+    const auto i = static_cast<std::size_t>(idx);
+    const float t = idx - static_cast<float>(i);
+
+    std::nth_element(vals.begin(), vals.begin() + static_cast<std::ptrdiff_t>(i), vals.end());
+    const float vi = vals[i];
+    if (i + 1 >= vals.size())
+        return vi;
+    const float vj = *std::min_element(vals.begin() + static_cast<std::ptrdiff_t>(i) + 1, vals.end());
+    return (1.0f - t) * vi + t * vj;
+}
+
+inline int reflect101(int i, int n)
+{
+    if (n == 1)
+        return 0;
+    if (i < 0)
+        i = -i;
+    if (i >= n)
+        i = 2 * n - 2 - i;
+    return i;
+}
+
+// |grad L| at a valid pixel, Sobel 3x3 with reflect-101 borders.
+inline float grad_mag_at(const cv::Mat& labRef, int x, int y)
+{
+    const int rows = labRef.rows;
+    const int cols = labRef.cols;
+    const float* r0 = labRef.ptr<float>(reflect101(y - 1, rows));
+    const float* r1 = labRef.ptr<float>(y);
+    const float* r2 = labRef.ptr<float>(reflect101(y + 1, rows));
+    const int xm = 3 * reflect101(x - 1, cols);
+    const int xc = 3 * x;
+    const int xp = 3 * reflect101(x + 1, cols);
+
+    const float gx = (r0[xp] + 2.0f * r1[xp] + r2[xp]) - (r0[xm] + 2.0f * r1[xm] + r2[xm]);
+    const float gy = (r2[xm] + 2.0f * r2[xc] + r2[xp]) - (r0[xm] + 2.0f * r0[xc] + r0[xp]);
+    return std::sqrt(gx * gx + gy * gy);
+}
+
+// Point version of compute_region_masks32's gradMag (Sobel, magnitude,
+// GaussianBlur 3x3 sigma 0.8), for threshold sampling.
+float blurred_grad_mag_at(const cv::Mat& labRef, int x, int y, const float gk[3])
+{
+    float sum = 0.0f;
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        const int yy = reflect101(y + dy, labRef.rows);
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            const int xx = reflect101(x + dx, labRef.cols);
+            sum += gk[dy + 1] * gk[dx + 1] * grad_mag_at(labRef, xx, yy);
+        }
+    }
+    return sum;
+}
+
+// Full-resolution gradMag of rect r, identical to computing it on the
+// whole image: the tile is processed with a 2-pixel margin (Sobel + blur
+// support), and where the margin is clipped the tile edge is the image
+// edge, so reflect-101 borders agree.
+cv::Mat blurred_grad_mag_tile(const cv::Mat& labRef, const cv::Rect& r)
+{
+    const cv::Rect m = cv::Rect(r.x - 2, r.y - 2, r.width + 4, r.height + 4) &
+                       cv::Rect(0, 0, labRef.cols, labRef.rows);
+
+    cv::Mat L, gx, gy, mag, blurred;
+    cv::extractChannel(labRef(m), L, 0);
+    cv::Sobel(L, gx, CV_32F, 1, 0, 3);
+    cv::Sobel(L, gy, CV_32F, 0, 1, 3);
+    cv::magnitude(gx, gy, mag);
+    cv::GaussianBlur(mag, blurred, cv::Size(3, 3), 0.8);
+
+    return blurred(cv::Rect(r.x - m.x, r.y - m.y, r.width, r.height));
+}
+
+} // anonymous namespace
+
+MultiResolutionRegionProvider::MultiResolutionRegionProvider(int downscale,
+                                                             float flatPercentile,
+                                                             float detailPercentile,
+                                                             int refineRadius)
+    : m_downscale(downscale)
+    , m_flatPercentile(flatPercentile)
+    , m_detailPercentile(detailPercentile)
+    , m_refineRadius(refineRadius)
+{
+    CV_Assert(downscale >= 2);
+    CV_Assert(refineRadius >= 0);
+}
+
+std::string MultiResolutionRegionProvider::parameters() const
+{
+    std::ostringstream os;
+    os << "downscale=" << m_downscale << ",refine=" << m_refineRadius
+       << ",flat=" << m_flatPercentile << ",detail=" << m_detailPercentile;
+    return os.str();
+}
+
+RegionMasks MultiResolutionRegionProvider::compute_regions(const cv::Mat& labRef) const
+{
+    CV_Assert(labRef.type() == CV_32FC3);
+    CV_Assert(!labRef.empty());
+
+    const int f    = m_downscale;
+    const int rows = labRef.rows;
+    const int cols = labRef.cols;
+
+    // 1) Segmentation on the reduced level. Low-res pixel (xs, ys) covers
+    //    full-res [xs*f, xs*f+f) x [ys*f, ys*f+f); the last column/row of
+    //    cells also takes the remainder when the size is not divisible.
+    const cv::Size small(std::max(1, cols / f), std::max(1, rows / f));
+    cv::Mat labSmall, Ls;
+    cv::resize(labRef, labSmall, small, 0, 0, cv::INTER_AREA);
+    cv::extractChannel(labSmall, Ls, 0);
+
+    cv::Mat gx, gy, mag, gradSmall;
+    cv::Sobel(Ls, gx, CV_32F, 1, 0, 3);
+    cv::Sobel(Ls, gy, CV_32F, 0, 1, 3);
+    cv::magnitude(gx, gy, mag);
+    cv::GaussianBlur(mag, gradSmall, cv::Size(3, 3), 0.8);
+
+    std::vector<float> vals;
+    vals.reserve(gradSmall.total());
+    for (int y = 0; y < gradSmall.rows; ++y)
+    {
+        const float* gRow = gradSmall.ptr<float>(y);
+        vals.insert(vals.end(), gRow, gRow + gradSmall.cols);
+    }
+    const float thrFlatSmall   = select_percentile(vals, m_flatPercentile);
+    const float thrDetailSmall = select_percentile(vals, m_detailPercentile);
+
+    cv::Mat labelsSmall(small, CV_8U);
+    for (int y = 0; y < small.height; ++y)
+    {
+        const float* gRow = gradSmall.ptr<float>(y);
+        uchar* lRow = labelsSmall.ptr<uchar>(y);
+        for (int x = 0; x < small.width; ++x)
+            lRow[x] = classify_grad(gRow[x], thrFlatSmall, thrDetailSmall);
+    }
+
+    // 2) Nearest-neighbour upsampling of labels; gradMag is interpolated and
+    //    rescaled (a low-res pixel step is f full-res steps).
+    RegionMasks masks;
+    masks.labels.create(labRef.size(), CV_8U);
+    for (int y = 0; y < rows; ++y)
+    {
+        const uchar* sRow = labelsSmall.ptr<uchar>(std::min(y / f, small.height - 1));
+        uchar* lRow = masks.labels.ptr<uchar>(y);
+        for (int xs = 0; xs < small.width; ++xs)
+        {
+            const int x0 = xs * f;
+            const int x1 = (xs == small.width - 1) ? cols : x0 + f;
+            std::fill(lRow + x0, lRow + x1, sRow[xs]);
+        }
+    }
+
+    cv::resize(gradSmall, masks.gradMag, labRef.size(), 0, 0, cv::INTER_LINEAR);
+    masks.gradMag.convertTo(masks.gradMag, CV_32F, 1.0 / static_cast<double>(f));
+
+    if (m_refineRadius == 0)
+        return masks;
+
+    // 3) Cells near a class boundary: min != max over the refine window.
+    const int k = 2 * m_refineRadius + 1;
+    const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(k, k));
+    cv::Mat hi, lo, boundary;
+    cv::dilate(labelsSmall, hi, kernel);
+    cv::erode(labelsSmall, lo, kernel);
+    cv::compare(hi, lo, boundary, cv::CMP_NE);
+
+    // 4) Full-resolution thresholds from a regular sample of pixels (one
+    //    per cell, thinned to at most kMaxThresholdSamples).
+    const cv::Mat gk64 = cv::getGaussianKernel(3, 0.8, CV_32F);
+    const float gk[3] = { gk64.at<float>(0), gk64.at<float>(1), gk64.at<float>(2) };
+
+    const std::size_t cells = static_cast<std::size_t>(small.area());
+    const int stride = std::max(1, static_cast<int>(std::ceil(
+        std::sqrt(static_cast<double>(cells) / static_cast<double>(kMaxThresholdSamples)))));
+
+    vals.clear();
+    for (int ys = 0; ys < small.height; ys += stride)
+    {
+        const int y = std::min(rows - 1, ys * f + f / 2);
+        for (int xs = 0; xs < small.width; xs += stride)
+        {
+            const int x = std::min(cols - 1, xs * f + f / 2);
+            vals.push_back(blurred_grad_mag_at(labRef, x, y, gk));
+        }
+    }
+    const float thrFlat   = select_percentile(vals, m_flatPercentile);
+    const float thrDetail = select_percentile(vals, m_detailPercentile);
+
+    // 5) Refine boundary cells at full resolution, tile by tile. Tiles own
+    //    disjoint output pixels, so tile rows run in parallel.
+    const int tilesX = (small.width  + kRefineTileCells - 1) / kRefineTileCells;
+    const int tilesY = (small.height + kRefineTileCells - 1) / kRefineTileCells;
+
+    // Full-res extent of cells [c0, c1) along an axis of n pixels / ns cells.
+    auto cell_span = [f](int c0, int c1, int ns, int n)
+    {
+        return cv::Range(c0 * f, (c1 == ns) ? n : c1 * f);
+    };
+
+    cv::parallel_for_(cv::Range(0, tilesY), [&](const cv::Range& range)
+    {
+        for (int ty = range.start; ty < range.end; ++ty)
+        {
+            const int cy0 = ty * kRefineTileCells;
+            const int cy1 = std::min(cy0 + kRefineTileCells, small.height);
+
+            for (int tx = 0; tx < tilesX; ++tx)
+            {
+                const int cx0 = tx * kRefineTileCells;
+                const int cx1 = std::min(cx0 + kRefineTileCells, small.width);
+
+                const cv::Rect cellRect(cx0, cy0, cx1 - cx0, cy1 - cy0);
+                if (cv::countNonZero(boundary(cellRect)) == 0)
+                    continue;
+
+                const cv::Range xr = cell_span(cx0, cx1, small.width, cols);
+                const cv::Range yr = cell_span(cy0, cy1, small.height, rows);
+                const cv::Rect tile(xr.start, yr.start, xr.end - xr.start, yr.end - yr.start);
+                const cv::Mat gm = blurred_grad_mag_tile(labRef, tile);
+
+                for (int cy = cy0; cy < cy1; ++cy)
+                {
+                    const uchar* bRow = boundary.ptr<uchar>(cy);
+                    const cv::Range py = cell_span(cy, cy + 1, small.height, rows);
+
+                    for (int cx = cx0; cx < cx1; ++cx)
+                    {
+                        if (bRow[cx] == 0)
+                            continue;
+
+                        const cv::Range px = cell_span(cx, cx + 1, small.width, cols);
+                        for (int y = py.start; y < py.end; ++y)
+                        {
+                            const float* tRow = gm.ptr<float>(y - tile.y) - tile.x;
+                            float* gRow = masks.gradMag.ptr<float>(y);
+                            uchar* lRow = masks.labels.ptr<uchar>(y);
+                            for (int x = px.start; x < px.end; ++x)
+                            {
+                                gRow[x] = tRow[x];
+                                lRow[x] = classify_grad(tRow[x], thrFlat, thrDetail);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    return masks;
+}
+
+RegionLabelAgreement
+MultiResolutionRegionProvider::agreement_with_full_resolution(const cv::Mat& labRef) const
+{
+    CV_Assert(labRef.type() == CV_32FC3);
+
+    cv::Mat L;
+    cv::extractChannel(labRef, L, 0);
+    const RegionMasks full   = compute_region_masks32(L, m_flatPercentile, m_detailPercentile);
+    const RegionMasks approx = compute_regions(labRef);
+
+    return compare_region_labels(approx.labels, full.labels);
 }
 
 
@@ -0,0 +1,271 @@
+#include "iqalab/region_pyramid.hpp"
+
+#include <algorithm>
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "iqalab/region_block_grid.hpp"
+
+namespace iqa {
+namespace regions {
+
+static_assert(BlockGrid8T::kBlockSize == kPyramidBaseBlock,
+              "pyramid base level is walked with BlockGrid8T");
+
+namespace {
+
+// Per-class area under a block (indexed by BlockClass value 0..2).
+using ClassAreas = std::array<int, 3>;
+
+// Sum the four children of every block of `parent` from `child`.
+void aggregate_level(const BlockStatsLevel& child, BlockStatsLevel& parent)
+{
+    for (int by = 0; by < parent.grid.blocksY; ++by) {
+        for (int bx = 0; bx < parent.grid.blocksX; ++bx) {
+            BlockStats& s = parent.stats[static_cast<std::size_t>(by) * parent.grid.blocksX + bx];
+            const int cx1 = std::min(2 * bx + 2, child.grid.blocksX);
+            const int cy1 = std::min(2 * by + 2, child.grid.blocksY);
+            for (int cy = 2 * by; cy < cy1; ++cy)
+                for (int cx = 2 * bx; cx < cx1; ++cx)
+                    s.merge(child.at(cx, cy));
+        }
+    }
+}
+
+float percentile_of_sorted(const std::vector<float>& sorted, float p)
+{
+    if (sorted.empty())
+        return 0.0f;
+    const float idx = std::clamp(p, 0.0f, 1.0f) * static_cast<float>(sorted.size() - 1);
+    const auto i = static_cast<std::size_t>(idx);
+    const std::size_t j = std::min(i + 1, sorted.size() - 1);
+    const float t = idx - static_cast<float>(i);
+    return (1.0f - t) * sorted[i] + t * sorted[j];
+}
+
+BlockClass dominant_class(const ClassAreas& a, int& dominantArea)
+{
+    int best = 0;
+    for (int c = 1; c < 3; ++c)
+        if (a[static_cast<std::size_t>(c)] > a[static_cast<std::size_t>(best)])
+            best = c;
+    dominantArea = a[static_cast<std::size_t>(best)];
+    return static_cast<BlockClass>(best);
+}
+
+struct QuadtreeState {
+    const BlockStatsPyramid* pyramid = nullptr;
+    // Per level, per block: unsplit leaf class, or None when split.
+    std::array<std::vector<uchar>, kPyramidLevels> leafClass;
+};
+
+void emit_leaves(const QuadtreeState& st, int level, int bx, int by,
+                 QuadtreeClassification& out)
+{
+    const BlockStatsLevel& lv = st.pyramid->levels[static_cast<std::size_t>(level)];
+    if (bx >= lv.grid.blocksX || by >= lv.grid.blocksY)
+        return;
+
+    const uchar cls = st.leafClass[static_cast<std::size_t>(level)]
+                                  [static_cast<std::size_t>(by) * lv.grid.blocksX + bx];
+    if (cls != static_cast<uchar>(BlockClass::None)) {
+        out.leaves.push_back(QuadtreeLeaf{level, bx, by, static_cast<BlockClass>(cls)});
+
+        // Paint the 8x8 blocks under this leaf.
+        const int span = 1 << level;
+        const int x0 = bx * span;
+        const int y0 = by * span;
+        const int x1 = std::min(x0 + span, out.classes.cols);
+        const int y1 = std::min(y0 + span, out.classes.rows);
+        for (int y = y0; y < y1; ++y) {
+            uchar* row = out.classes.ptr<uchar>(y);
+            std::fill(row + x0, row + x1, cls);
+        }
+        return;
+    }
+
+    emit_leaves(st, level - 1, 2 * bx,     2 * by,     out);
+    emit_leaves(st, level - 1, 2 * bx + 1, 2 * by,     out);
+    emit_leaves(st, level - 1, 2 * bx,     2 * by + 1, out);
+    emit_leaves(st, level - 1, 2 * bx + 1, 2 * by + 1, out);
+}
+
+} // anonymous namespace
+
+const BlockStatsLevel& BlockStatsPyramid::level_for_block_size(int blockSize) const
+{
+    for (const BlockStatsLevel& lv : levels)
+        if (lv.grid.blockSize == blockSize)
+            return lv;
+    CV_Error(cv::Error::StsBadArg, "BlockStatsPyramid: unsupported block size");
+}
+
+BlockStatsPyramid build_block_stats_pyramid(const cv::Mat& labRef,
+                                            const cv::Mat& labDist)
+{
+    CV_Assert(labRef.type() == CV_32FC3);
+    CV_Assert(!labRef.empty());
+    CV_Assert(labDist.empty() || (labDist.type() == CV_32FC3 && labDist.size() == labRef.size()));
+
+    BlockStatsPyramid pyr;
+    pyr.imageSize = labRef.size();
+    for (int k = 0; k < kPyramidLevels; ++k) {
+        BlockStatsLevel& lv = pyr.levels[static_cast<std::size_t>(k)];
+        lv.grid = make_block16_grid(labRef.size(), kPyramidBaseBlock << k);
+        lv.stats.assign(static_cast<std::size_t>(lv.grid.blocksX) * lv.grid.blocksY, BlockStats());
+    }
+
+    // Same gradient operator as the block / pixelwise providers.
+    cv::Mat L;
+    cv::extractChannel(labRef, L, 0);
+    cv::Mat gx, gy;
+    cv::Sobel(L, gx, CV_32F, 1, 0, 3);
+    cv::Sobel(L, gy, CV_32F, 0, 1, 3);
+
+    const bool hasDist = !labDist.empty();
+    BlockStatsLevel& base = pyr.levels[0];
+
+    // Finest level: one task per 8-row block row, each owning its blocks.
+    const BlockGrid8T baseGrid(labRef.size());
+    const BlockRowSegments<BlockGrid8T> segments = block_row_segments(baseGrid);
+    cv::parallel_for_(cv::Range(0, baseGrid.blocks_y()), [&](const cv::Range& range)
+    {
+        for (int by = range.start; by < range.end; ++by) {
+            BlockStats* blocks = base.stats.data() + static_cast<std::size_t>(by) * baseGrid.blocks_x();
+            const cv::Range blockRows = block_row_span(baseGrid, by);
+
+            for (int y = blockRows.start; y < blockRows.end; ++y) {
+                const float* gxRow = gx.ptr<float>(y);
+                const float* gyRow = gy.ptr<float>(y);
+                const float* rRow  = labRef.ptr<float>(y);
+                const float* dRow  = hasDist ? labDist.ptr<float>(y) : nullptr;
+
+                for (const BlockRowSegment& seg : segments) {
+                    const int x0 = seg.x0;
+                    const int x1 = seg.x1;
+
+                    // Per-row partial sums in float (at most 8 terms).
+                    float g = 0.0f;
+                    for (int x = x0; x < x1; ++x)
+                        g += gxRow[x] * gxRow[x] + gyRow[x] * gyRow[x];
+
+                    BlockStats& s = blocks[seg.bx];
+                    s.gradEnergy += g;
+                    s.area += x1 - x0;
+
+                    if (dRow != nullptr) {
+                        float d0 = 0.0f, d1 = 0.0f, d2 = 0.0f;
+                        for (int x = x0; x < x1; ++x) {
+                            const float e0 = rRow[3 * x]     - dRow[3 * x];
+                            const float e1 = rRow[3 * x + 1] - dRow[3 * x + 1];
+                            const float e2 = rRow[3 * x + 2] - dRow[3 * x + 2];
+                            d0 += e0 * e0;
+                            d1 += e1 * e1;
+                            d2 += e2 * e2;
+                        }
+                        s.diffSq[0] += d0;
+                        s.diffSq[1] += d1;
+                        s.diffSq[2] += d2;
+                    }
+                }
+            }
+        }
+    });
+
+    // Coarser levels from their children only.
+    for (int k = 1; k < kPyramidLevels; ++k)
+        aggregate_level(pyr.levels[static_cast<std::size_t>(k - 1)],
+                        pyr.levels[static_cast<std::size_t>(k)]);
+
+    return pyr;
+}
+
+QuadtreeClassification classify_quadtree(const BlockStatsPyramid& pyramid,
+                                         float flatPercentile,
+                                         float detailPercentile,
+                                         double minUniformFrac)
+{
+    CV_Assert(minUniformFrac > 0.0 && minUniformFrac <= 1.0);
+
+    const BlockStatsLevel& base = pyramid.levels[0];
+
+    // 8x8 classes from block-level percentiles.
+    std::vector<float> energy(base.stats.size());
+    for (std::size_t i = 0; i < base.stats.size(); ++i)
+        energy[i] = static_cast<float>(base.stats[i].mean_grad_energy());
+
+    std::vector<float> sorted = energy;
+    std::sort(sorted.begin(), sorted.end());
+    const float thrFlat   = percentile_of_sorted(sorted, flatPercentile);
+    const float thrDetail = percentile_of_sorted(sorted, detailPercentile);
+
+    QuadtreeState st;
+    st.pyramid = &pyramid;
+
+    // Bottom-up: per-class areas and the unsplit/split decision per block.
+    std::vector<ClassAreas> areas(base.stats.size());
+    st.leafClass[0].resize(base.stats.size());
+    for (std::size_t i = 0; i < base.stats.size(); ++i) {
+        BlockClass cls = BlockClass::Mid;
+        if (energy[i] <= thrFlat)
+            cls = BlockClass::Flat;
+        else if (energy[i] >= thrDetail)
+            cls = BlockClass::Detail;
+        st.leafClass[0][i] = static_cast<uchar>(cls);
+        areas[i] = ClassAreas{};
+        areas[i][static_cast<std::size_t>(cls)] = base.stats[i].area;
+    }
+
+    for (int k = 1; k < kPyramidLevels; ++k) {
+        const BlockStatsLevel& child  = pyramid.levels[static_cast<std::size_t>(k - 1)];
+        const BlockStatsLevel& parent = pyramid.levels[static_cast<std::size_t>(k)];
+        const std::vector<uchar>& childLeaf = st.leafClass[static_cast<std::size_t>(k - 1)];
+        std::vector<uchar>& leaf = st.leafClass[static_cast<std::size_t>(k)];
+
+        std::vector<ClassAreas> parentAreas(parent.stats.size(), ClassAreas{});
+        leaf.assign(parent.stats.size(), static_cast<uchar>(BlockClass::None));
+
+        for (int by = 0; by < parent.grid.blocksY; ++by) {
+            for (int bx = 0; bx < parent.grid.blocksX; ++bx) {
+                const std::size_t pi = static_cast<std::size_t>(by) * parent.grid.blocksX + bx;
+                bool childrenUnsplit = true;
+
+                const int cx1 = std::min(2 * bx + 2, child.grid.blocksX);
+                const int cy1 = std::min(2 * by + 2, child.grid.blocksY);
+                for (int cy = 2 * by; cy < cy1; ++cy) {
+                    for (int cx = 2 * bx; cx < cx1; ++cx) {
+                        const std::size_t ci = static_cast<std::size_t>(cy) * child.grid.blocksX + cx;
+                        for (int c = 0; c < 3; ++c)
+                            parentAreas[pi][static_cast<std::size_t>(c)] += areas[ci][static_cast<std::size_t>(c)];
+                        childrenUnsplit = childrenUnsplit &&
+                                          childLeaf[ci] != static_cast<uchar>(BlockClass::None);
+                    }
+                }
+
+                int dominantArea = 0;
+                const BlockClass cls = dominant_class(parentAreas[pi], dominantArea);
+                const int area = parent.stats[pi].area;
+                if (childrenUnsplit && area > 0 &&
+                    static_cast<double>(dominantArea) >= minUniformFrac * static_cast<double>(area))
+                    leaf[pi] = static_cast<uchar>(cls);
+            }
+        }
+
+        areas.swap(parentAreas);
+    }
+
+    // Top-down: emit leaves and paint the 8x8 class grid.
+    QuadtreeClassification out;
+    out.classes.create(base.grid.blocksY, base.grid.blocksX);
+    const int top = kPyramidLevels - 1;
+    const BlockStatsLevel& topLevel = pyramid.levels[static_cast<std::size_t>(top)];
+    for (int by = 0; by < topLevel.grid.blocksY; ++by)
+        for (int bx = 0; bx < topLevel.grid.blocksX; ++bx)
+            emit_leaves(st, top, bx, by, out);
+
+    return out;
+}
+
+} // namespace regions
+} // namespace iqa
@@ -0,0 +1,125 @@
+#include "iqalab/screening.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "iqalab/blur.hpp"
+#include "iqalab/image_cache.hpp"
+#include "iqalab/iqalab.hpp"
+#include "iqalab/mapped_image.hpp"
+#include "iqalab/mse.hpp"
+
+namespace fs = std::filesystem;
+
+namespace iqa
+{
+
+namespace
+{
+
+// Pairs screened by one task; they share at most one reference decode.
+constexpr std::size_t kChunkPairs = 16;
+
+int reduced_read_flag(int reduction)
+{
+    switch (reduction) {
+    case 2: return cv::IMREAD_REDUCED_COLOR_2;
+    case 4: return cv::IMREAD_REDUCED_COLOR_4;
+    case 8: return cv::IMREAD_REDUCED_COLOR_8;
+    default: break;
+    }
+    CV_Error(cv::Error::StsBadArg, "screening reduction must be 1, 2, 4 or 8");
+}
+
+// [begin, end) ranges of `pairs` with one reference and at most kChunkPairs pairs.
+std::vector<cv::Range> reference_chunks(const std::vector<utils::ImagePair>& pairs)
+{
+    std::vector<cv::Range> chunks;
+    std::size_t begin = 0;
+    for (std::size_t i = 1; i <= pairs.size(); ++i) {
+        if (i == pairs.size() || pairs[i].refPath != pairs[begin].refPath ||
+            i - begin == kChunkPairs) {
+            chunks.emplace_back(static_cast<int>(begin), static_cast<int>(i));
+            begin = i;
+        }
+    }
+    return chunks;
+}
+
+} // anonymous namespace
+
+cv::Mat read_image_reduced(const fs::path& path, int reduction)
+{
+    if (reduction == 1)
+        return read_image_bgr(path);
+
+    const int flag = reduced_read_flag(reduction);
+    try {
+        return cv::imread(path.string(), flag);
+    } catch (const cv::Exception&) {
+        return cv::Mat();
+    }
+}
+
+ScreeningResult screen_reduced_pair(const cv::Mat& refReduced,
+                                    const cv::Mat& distReduced,
+                                    const ScreeningOptions& options)
+{
+    ScreeningResult result;
+    if (refReduced.empty() || distReduced.empty())
+        return result;
+    result.readable = true;
+    if (std::abs(refReduced.cols - distReduced.cols) > 1 ||
+        std::abs(refReduced.rows - distReduced.rows) > 1) {
+        result.sizeMismatch = true;
+        return result;
+    }
+
+    const cv::Rect common(0, 0,
+                          std::min(refReduced.cols, distReduced.cols),
+                          std::min(refReduced.rows, distReduced.rows));
+    const cv::Mat ref  = refReduced(common);
+    const cv::Mat dist = distReduced(common);
+
+    result.mse = mse::compute_mse(ref, dist);
+    result.blurL = blur::relative_blur_L(lab32_from_bgr8(ref), lab32_from_bgr8(dist));
+
+    // An 8x8 JPEG block shrinks to 8/reduction pixels; at reduction 8 the
+    // grid is gone and blocking cannot be measured.
+    const int blockSize = 8 / options.reduction;
+    if (blockSize >= 2 && dist.cols >= 2 * blockSize && dist.rows >= 2 * blockSize)
+        result.blocking = blocking_score(dist, blockSize);
+
+    result.promoted = result.mse >= options.mseThreshold ||
+                      result.blurL >= options.blurThreshold ||
+                      result.blocking >= options.blockingThreshold;
+    return result;
+}
+
+std::vector<ScreeningResult> screen_pairs(const std::vector<utils::ImagePair>& pairs,
+                                          const ScreeningOptions& options)
+{
+    if (options.reduction != 1)
+        reduced_read_flag(options.reduction);   // validate before spawning work
+
+    std::vector<ScreeningResult> results(pairs.size());
+    const std::vector<cv::Range> chunks = reference_chunks(pairs);
+
+    cv::parallel_for_(cv::Range(0, static_cast<int>(chunks.size())), [&](const cv::Range& r) {
+        for (int c = r.start; c < r.end; ++c) {
+            const cv::Range chunk = chunks[static_cast<std::size_t>(c)];
+            const cv::Mat ref = read_image_reduced(pairs[chunk.start].refPath, options.reduction);
+            for (int i = chunk.start; i < chunk.end; ++i) {
+                const cv::Mat dist = read_image_reduced(pairs[i].distPath, options.reduction);
+                results[i] = screen_reduced_pair(ref, dist, options);
+            }
+        }
+    });
+
+    return results;
+}
+
+} // namespace iqa
@@ -0,0 +1,303 @@
+#include "iqalab/superpixels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <opencv2/core/utility.hpp>
+
+namespace iqa {
+namespace regions {
+
+namespace {
+
+// Row band height for parallel assignment / accumulation.
+constexpr int kSlicBandRows = 32;
+
+struct ClusterCenter
+{
+    float L = 0.0f, a = 0.0f, b = 0.0f;
+    float x = 0.0f, y = 0.0f;
+};
+
+struct ClusterSums
+{
+    double L = 0.0, a = 0.0, b = 0.0;
+    double x = 0.0, y = 0.0;
+    double grad = 0.0;
+    std::size_t n = 0;
+
+    void merge(const ClusterSums& o)
+    {
+        L += o.L; a += o.a; b += o.b;
+        x += o.x; y += o.y;
+        grad += o.grad;
+        n += o.n;
+    }
+};
+
+// Regular seed grid with roughly desiredSuperpixels cells.
+std::vector<ClusterCenter> make_seeds(const cv::Mat& L,
+                                      const cv::Mat& A,
+                                      const cv::Mat& B,
+                                      int desiredSuperpixels,
+                                      float& S)
+{
+    const int rows = L.rows;
+    const int cols = L.cols;
+
+    const double N = static_cast<double>(rows) * static_cast<double>(cols);
+    S = static_cast<float>(std::max(1.0, std::sqrt(N / std::max(1, desiredSuperpixels))));
+
+    const int nx = std::max(1, static_cast<int>(std::lround(cols / S)));
+    const int ny = std::max(1, static_cast<int>(std::lround(rows / S)));
+    const double sx = static_cast<double>(cols) / nx;
+    const double sy = static_cast<double>(rows) / ny;
+
+    std::vector<ClusterCenter> centers;
+    centers.reserve(static_cast<std::size_t>(nx) * ny);
+    for (int j = 0; j < ny; ++j)
+    {
+        for (int i = 0; i < nx; ++i)
+        {
+            const int x = std::min(cols - 1, static_cast<int>(sx * (i + 0.5)));
+            const int y = std::min(rows - 1, static_cast<int>(sy * (j + 0.5)));
+            ClusterCenter c;
+            c.L = L.at<float>(y, x);
+            c.a = A.at<float>(y, x);
+            c.b = B.at<float>(y, x);
+            c.x = static_cast<float>(x);
+            c.y = static_cast<float>(y);
+            centers.push_back(c);
+        }
+    }
+    return centers;
+}
+
+// Assign every pixel of row y to the closest candidate cluster.
+//
+// candidates: cluster indices whose center row is within S of y.
+// best / label: per-pixel scratch for this row.
+void assign_row(int y,
+                const float* Lrow,
+                const float* Arow,
+                const float* Brow,
+                int cols,
+                const std::vector<ClusterCenter>& centers,
+                const int* candBegin,
+                const int* candEnd,
+                float S,
+                float spatialWeight,
+                float* best,
+                int* label)
+{
+    std::fill(best, best + cols, std::numeric_limits<float>::max());
+    std::fill(label, label + cols, -1);
+
+    for (const int* it = candBegin; it != candEnd; ++it)
+    {
+        const int k = *it;
+        const ClusterCenter& c = centers[static_cast<std::size_t>(k)];
+
+        const int x0 = std::max(0, static_cast<int>(std::floor(c.x - S)));
+        const int x1 = std::min(cols, static_cast<int>(std::ceil(c.x + S)) + 1);
+        const float dy = static_cast<float>(y) - c.y;
+        const float dy2 = dy * dy * spatialWeight;
+
+        // Branch-free distance + select: vectorizes over x.
+        for (int x = x0; x < x1; ++x)
+        {
+            const float dl = Lrow[x] - c.L;
+            const float da = Arow[x] - c.a;
+            const float db = Brow[x] - c.b;
+            const float dx = static_cast<float>(x) - c.x;
+            const float d  = dl * dl + da * da + db * db + dx * dx * spatialWeight + dy2;
+            const bool better = d < best[x];
+            best[x]  = better ? d : best[x];
+            label[x] = better ? k : label[x];
+        }
+    }
+
+    // Pixels outside every window (possible after centers drift):
+    // take the label of the nearest assigned pixel in the row, else the
+    // nearest candidate center spatially.
+    int last = -1;
+    for (int x = 0; x < cols; ++x)
+    {
+        if (label[x] >= 0)
+            last = label[x];
+        else if (last >= 0)
+            label[x] = last;
+    }
+    if (cols > 0 && label[0] < 0)
+    {
+        int first = -1;
+        for (int x = 0; x < cols && first < 0; ++x)
+            first = label[x];
+        if (first < 0)
+        {
+            float bestD = std::numeric_limits<float>::max();
+            for (int k = 0; k < static_cast<int>(centers.size()); ++k)
+            {
+                const float dx = centers[static_cast<std::size_t>(k)].x;
+                const float dy = centers[static_cast<std::size_t>(k)].y - static_cast<float>(y);
+                const float d = dx * dx + dy * dy;
+                if (d < bestD)
+                {
+                    bestD = d;
+                    first = k;
+                }
+            }
+        }
+        for (int x = 0; x < cols && label[x] < 0; ++x)
+            label[x] = first;
+    }
+}
+
+} // anonymous namespace
+
+SuperpixelSegmentation slic_superpixels(const cv::Mat& labRef,
+                                        int desiredSuperpixels,
+                                        float compactness,
+                                        const cv::Mat& gradMag,
+                                        int iterations)
+{
+    CV_Assert(labRef.type() == CV_32FC3);
+    CV_Assert(!labRef.empty());
+    CV_Assert(gradMag.empty() || (gradMag.type() == CV_32F && gradMag.size() == labRef.size()));
+    CV_Assert(iterations >= 1);
+
+    const int rows = labRef.rows;
+    const int cols = labRef.cols;
+
+    std::vector<cv::Mat> planes;
+    cv::split(labRef, planes);
+    const cv::Mat& L = planes[0];
+    const cv::Mat& A = planes[1];
+    const cv::Mat& B = planes[2];
+
+    float S = 1.0f;
+    std::vector<ClusterCenter> centers = make_seeds(L, A, B, desiredSuperpixels, S);
+    const int K = static_cast<int>(centers.size());
+
+    const float spatialWeight = (compactness * compactness) / (S * S);
+
+    SuperpixelSegmentation out;
+    out.labels.create(rows, cols, CV_32S);
+    out.count = K;
+
+    const int bandCount = (rows + kSlicBandRows - 1) / kSlicBandRows;
+    std::vector<ClusterSums> bandSums(static_cast<std::size_t>(bandCount) * K);
+
+    // Cluster indices sorted by center row, for candidate lookup per row.
+    std::vector<int> order(static_cast<std::size_t>(K));
+    std::vector<float> orderY(static_cast<std::size_t>(K));
+
+    for (int it = 0; it < iterations; ++it)
+    {
+        const bool lastPass = (it == iterations - 1);
+        const bool gatherGrad = lastPass && !gradMag.empty();
+
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&centers](int p, int q)
+        {
+            return centers[static_cast<std::size_t>(p)].y < centers[static_cast<std::size_t>(q)].y;
+        });
+        for (int i = 0; i < K; ++i)
+            orderY[static_cast<std::size_t>(i)] = centers[static_cast<std::size_t>(order[static_cast<std::size_t>(i)])].y;
+
+        std::fill(bandSums.begin(), bandSums.end(), ClusterSums());
+
+        cv::parallel_for_(cv::Range(0, bandCount), [&](const cv::Range& range)
+        {
+            std::vector<float> best(static_cast<std::size_t>(cols));
+
+            for (int band = range.start; band < range.end; ++band)
+            {
+                ClusterSums* sums = bandSums.data() + static_cast<std::size_t>(band) * K;
+                const int y0 = band * kSlicBandRows;
+                const int y1 = std::min(rows, y0 + kSlicBandRows);
+
+                for (int y = y0; y < y1; ++y)
+                {
+                    const auto lo = std::lower_bound(orderY.begin(), orderY.end(),
+                                                     static_cast<float>(y) - S);
+                    const auto hi = std::upper_bound(orderY.begin(), orderY.end(),
+                                                     static_cast<float>(y) + S);
+                    const int* candBegin = order.data() + (lo - orderY.begin());
+                    const int* candEnd   = order.data() + (hi - orderY.begin());
+
+                    const float* Lrow = L.ptr<float>(y);
+                    const float* Arow = A.ptr<float>(y);
+                    const float* Brow = B.ptr<float>(y);
+                    int* lRow = out.labels.ptr<int>(y);
+
+                    assign_row(y, Lrow, Arow, Brow, cols, centers,
+                               candBegin, candEnd, S, spatialWeight,
+                               best.data(), lRow);
+
+                    const float* gRow = gatherGrad ? gradMag.ptr<float>(y) : nullptr;
+                    for (int x = 0; x < cols; ++x)
+                    {
+                        ClusterSums& s = sums[lRow[x]];
+                        s.L += Lrow[x];
+                        s.a += Arow[x];
+                        s.b += Brow[x];
+                        s.x += x;
+                        s.y += y;
+                        ++s.n;
+                        if (gRow != nullptr)
+                            s.grad += gRow[x];
+                    }
+                }
+            }
+        });
+
+        // Reduce band sums in band order and move centers.
+        std::vector<ClusterSums> total(static_cast<std::size_t>(K));
+        for (int band = 0; band < bandCount; ++band)
+        {
+            const ClusterSums* sums = bandSums.data() + static_cast<std::size_t>(band) * K;
+            for (int k = 0; k < K; ++k)
+                total[static_cast<std::size_t>(k)].merge(sums[k]);
+        }
+
+        for (int k = 0; k < K; ++k)
+        {
+            const ClusterSums& s = total[static_cast<std::size_t>(k)];
+            if (s.n == 0)
+                continue; // empty cluster keeps its center
+            const double inv = 1.0 / static_cast<double>(s.n);
+            ClusterCenter& c = centers[static_cast<std::size_t>(k)];
+            c.L = static_cast<float>(s.L * inv);
+            c.a = static_cast<float>(s.a * inv);
+            c.b = static_cast<float>(s.b * inv);
+            c.x = static_cast<float>(s.x * inv);
+            c.y = static_cast<float>(s.y * inv);
+        }
+
+        if (lastPass)
+        {
+            out.area.resize(static_cast<std::size_t>(K));
+            for (int k = 0; k < K; ++k)
+                out.area[static_cast<std::size_t>(k)] = static_cast<int>(total[static_cast<std::size_t>(k)].n);
+
+            if (gatherGrad)
+            {
+                out.meanGradient.resize(static_cast<std::size_t>(K));
+                for (int k = 0; k < K; ++k)
+                {
+                    const ClusterSums& s = total[static_cast<std::size_t>(k)];
+                    out.meanGradient[static_cast<std::size_t>(k)] =
+                        (s.n > 0) ? s.grad / static_cast<double>(s.n) : 0.0;
+                }
+            }
+        }
+    }
+
+    return out;
+}
+
+} // namespace regions
+} // namespace iqa
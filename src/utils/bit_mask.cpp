@@ -0,0 +1,290 @@
+#include "iqalab/utils/bit_mask.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace iqa {
+
+BitMask::BitMask(int rows, int cols)
+    : m_rows(rows)
+    , m_cols(cols)
+    , m_wordsPerRow((cols + 63) / 64)
+    , m_words(static_cast<std::size_t>(rows) * static_cast<std::size_t>((cols + 63) / 64), 0)
+{
+    CV_Assert(rows >= 0 && cols >= 0);
+}
+
+BitMask BitMask::from_mat(const cv::Mat& mask, uchar threshold)
+{
+    CV_Assert(mask.type() == CV_8U);
+
+    BitMask out(mask.rows, mask.cols);
+    for (int y = 0; y < mask.rows; ++y)
+        out.assign_row(y, mask.ptr<uchar>(y), threshold);
+    return out;
+}
+
+BitMask BitMask::from_label(const cv::Mat& labels, uchar label)
+{
+    CV_Assert(labels.type() == CV_8U);
+
+    BitMask out(labels.rows, labels.cols);
+    for (int y = 0; y < labels.rows; ++y) {
+        const uchar* lrow = labels.ptr<uchar>(y);
+        std::uint64_t* wrow = out.row(y);
+
+        for (int w = 0; w < out.m_wordsPerRow; ++w) {
+            const int x0 = w * 64;
+            const int n  = std::min(64, labels.cols - x0);
+            std::uint64_t bits = 0;
+            for (int i = 0; i < n; ++i)
+                bits |= static_cast<std::uint64_t>(lrow[x0 + i] == label) << i;
+            wrow[w] = bits;
+        }
+    }
+    return out;
+}
+
+void BitMask::assign_row(int y, const uchar* values, uchar threshold)
+{
+    CV_Assert(y >= 0 && y < m_rows);
+
+    std::uint64_t* wrow = row(y);
+    for (int w = 0; w < m_wordsPerRow; ++w) {
+        const int x0 = w * 64;
+        const int n  = std::min(64, m_cols - x0);
+        std::uint64_t bits = 0;
+        for (int i = 0; i < n; ++i)
+            bits |= static_cast<std::uint64_t>(values[x0 + i] >= threshold) << i;
+        wrow[w] = bits;
+    }
+}
+
+cv::Mat BitMask::to_mat() const
+{
+    cv::Mat out(m_rows, m_cols, CV_8U);
+    for (int y = 0; y < m_rows; ++y) {
+        const std::uint64_t* wrow = row(y);
+        uchar* mrow = out.ptr<uchar>(y);
+
+        for (int w = 0; w < m_wordsPerRow; ++w) {
+            const int x0 = w * 64;
+            const int n  = std::min(64, m_cols - x0);
+            const std::uint64_t bits = wrow[w];
+            if (bits == 0) {
+                std::fill(mrow + x0, mrow + x0 + n, uchar(0));
+                continue;
+            }
+            for (int i = 0; i < n; ++i)
+                mrow[x0 + i] = ((bits >> i) & 1u) ? 255 : 0;
+        }
+    }
+    return out;
+}
+
+std::size_t BitMask::count() const
+{
+    std::size_t n = 0;
+    for (std::uint64_t w : m_words)
+        n += static_cast<std::size_t>(std::popcount(w));
+    return n;
+}
+
+BitMask& BitMask::operator&=(const BitMask& other)
+{
+    CV_Assert(size() == other.size());
+    for (std::size_t i = 0; i < m_words.size(); ++i)
+        m_words[i] &= other.m_words[i];
+    return *this;
+}
+
+BitMask& BitMask::operator|=(const BitMask& other)
+{
+    CV_Assert(size() == other.size());
+    for (std::size_t i = 0; i < m_words.size(); ++i)
+        m_words[i] |= other.m_words[i];
+    return *this;
+}
+
+BitMask operator&(BitMask a, const BitMask& b)
+{
+    a &= b;
+    return a;
+}
+
+BitMask operator|(BitMask a, const BitMask& b)
+{
+    a |= b;
+    return a;
+}
+
+void BitMask::clear_padding()
+{
+    const int tail = m_cols & 63;
+    if (tail == 0 || m_wordsPerRow == 0)
+        return;
+
+    const std::uint64_t keep = (std::uint64_t(1) << tail) - 1;
+    for (int y = 0; y < m_rows; ++y)
+        row(y)[m_wordsPerRow - 1] &= keep;
+}
+
+void BitMask::dilate_rows_once(BitMask& out) const
+{
+    // Neighbours within a word by shifts, across word boundaries by
+    // carrying the edge bit of the adjacent word.
+    const int W = m_wordsPerRow;
+    for (int y = 0; y < m_rows; ++y) {
+        const std::uint64_t* in = row(y);
+        std::uint64_t* dst = out.row(y);
+        for (int w = 0; w < W; ++w) {
+            const std::uint64_t prev = (w > 0)     ? in[w - 1] : 0;
+            const std::uint64_t next = (w + 1 < W) ? in[w + 1] : 0;
+            dst[w] = in[w]
+                   | (in[w] << 1) | (prev >> 63)
+                   | (in[w] >> 1) | (next << 63);
+        }
+    }
+    out.clear_padding();
+}
+
+BitMask BitMask::dilated(int radius) const
+{
+    CV_Assert(radius >= 0);
+
+    BitMask cur = *this;
+    if (empty())
+        return cur;
+
+    BitMask horiz(m_rows, m_cols);
+    const int W = m_wordsPerRow;
+
+    for (int pass = 0; pass < radius; ++pass) {
+        cur.dilate_rows_once(horiz);
+
+        // Vertical 3x1 on whole words.
+        for (int y = 0; y < m_rows; ++y) {
+            const std::uint64_t* up   = horiz.row(y > 0 ? y - 1 : y);
+            const std::uint64_t* mid  = horiz.row(y);
+            const std::uint64_t* down = horiz.row(y + 1 < m_rows ? y + 1 : y);
+            std::uint64_t* out = cur.row(y);
+            for (int w = 0; w < W; ++w)
+                out[w] = up[w] | mid[w] | down[w];
+        }
+    }
+
+    return cur;
+}
+
+BitMask BitMask::dilated(const cv::Mat& kernel) const
+{
+    CV_Assert(kernel.type() == CV_8U);
+    CV_Assert(kernel.rows % 2 == 1 && kernel.cols % 2 == 1);
+
+    const int anchorY = kernel.rows / 2;
+    const int anchorX = kernel.cols / 2;
+
+    // Half-width of the run in each kernel row; -1 for an empty row.
+    std::vector<int> half(static_cast<std::size_t>(kernel.rows), -1);
+    int maxHalf = -1;
+    for (int i = 0; i < kernel.rows; ++i) {
+        const uchar* k = kernel.ptr<uchar>(i);
+        int first = -1, last = -1;
+        for (int j = 0; j < kernel.cols; ++j) {
+            if (k[j] == 0)
+                continue;
+            if (first < 0)
+                first = j;
+            last = j;
+        }
+        if (first < 0)
+            continue;
+
+        CV_Assert(first + last == 2 * anchorX);
+        for (int j = first; j <= last; ++j)
+            CV_Assert(k[j] != 0);
+
+        half[i] = anchorX - first;
+        maxHalf = std::max(maxHalf, half[i]);
+    }
+
+    BitMask out(m_rows, m_cols);
+    if (empty() || maxHalf < 0)
+        return out;
+
+    // Rows dilated horizontally by 0..maxHalf pixels, built incrementally.
+    std::vector<BitMask> horiz(static_cast<std::size_t>(maxHalf) + 1);
+    horiz[0] = *this;
+    for (int h = 1; h <= maxHalf; ++h) {
+        horiz[h] = BitMask(m_rows, m_cols);
+        horiz[h - 1].dilate_rows_once(horiz[h]);
+    }
+
+    // Rows outside the image contribute nothing, as with cv::dilate's
+    // default border.
+    const int W = m_wordsPerRow;
+    for (int y = 0; y < m_rows; ++y) {
+        std::uint64_t* dst = out.row(y);
+        for (int i = 0; i < kernel.rows; ++i) {
+            const int sy = y + i - anchorY;
+            if (half[i] < 0 || sy < 0 || sy >= m_rows)
+                continue;
+            const std::uint64_t* src = horiz[half[i]].row(sy);
+            for (int w = 0; w < W; ++w)
+                dst[w] |= src[w];
+        }
+    }
+    return out;
+}
+
+double masked_sum(const cv::Mat& values, const BitMask& mask)
+{
+    CV_Assert(values.type() == CV_32F);
+    CV_Assert(values.size() == mask.size());
+
+    double sum = 0.0;
+    for (int y = 0; y < mask.rows(); ++y) {
+        const float* vrow = values.ptr<float>(y);
+        const std::uint64_t* wrow = mask.row(y);
+        for (int w = 0; w < mask.words_per_row(); ++w) {
+            std::uint64_t bits = wrow[w];
+            const float* v = vrow + w * 64;
+            while (bits != 0) {
+                sum += v[std::countr_zero(bits)];
+                bits &= bits - 1;
+            }
+        }
+    }
+    return sum;
+}
+
+double masked_mean_sq_diff(const cv::Mat& a, const cv::Mat& b, const BitMask& mask)
+{
+    CV_Assert(a.type() == CV_32F && b.type() == CV_32F);
+    CV_Assert(a.size() == b.size());
+    CV_Assert(a.size() == mask.size());
+
+    double sum = 0.0;
+    std::size_t n = 0;
+    for (int y = 0; y < mask.rows(); ++y) {
+        const float* arow = a.ptr<float>(y);
+        const float* brow = b.ptr<float>(y);
+        const std::uint64_t* wrow = mask.row(y);
+        for (int w = 0; w < mask.words_per_row(); ++w) {
+            std::uint64_t bits = wrow[w];
+            if (bits == 0)
+                continue;
+            n += static_cast<std::size_t>(std::popcount(bits));
+            const int x0 = w * 64;
+            while (bits != 0) {
+                const int x = x0 + std::countr_zero(bits);
+                const double d = static_cast<double>(arow[x]) - static_cast<double>(brow[x]);
+                sum += d * d;
+                bits &= bits - 1;
+            }
+        }
+    }
+    return (n > 0) ? sum / static_cast<double>(n) : 0.0;
+}
+
+} // namespace iqa
@@ -0,0 +1,95 @@
+#include "iqalab/utils/content_hash.hpp"
+
+#include <bit>
+#include <cstring>
+
+namespace iqa {
+namespace utils {
+
+namespace {
+
+constexpr std::uint64_t kMul1 = 0x9E3779B97F4A7C15ull;
+constexpr std::uint64_t kMul2 = 0xC2B2AE3D27D4EB4Full;
+
+// splitmix64 finalizer.
+inline std::uint64_t avalanche(std::uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+    return h;
+}
+
+inline std::uint64_t mix_word(std::uint64_t h, std::uint64_t w)
+{
+    h ^= std::rotl(w * kMul2, 31) * kMul1;
+    return std::rotl(h, 27) * kMul1 + 0x52DCE729ull;
+}
+
+} // anonymous namespace
+
+std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::uint64_t h = seed ^ (static_cast<std::uint64_t>(size) * kMul1);
+
+    // Four independent lanes over 32-byte chunks, then the tail.
+    std::uint64_t lane[4] = { h, h ^ kMul2, h + kMul1, h - kMul2 };
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int k = 0; k < 4; ++k) {
+            std::uint64_t w;
+            std::memcpy(&w, p + i + 8 * k, 8);
+            lane[k] = mix_word(lane[k], w);
+        }
+    }
+    for (int k = 0; k < 4; ++k)
+        h = mix_word(h, lane[k]);
+
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = mix_word(h, w);
+    }
+    if (i < size) {
+        std::uint64_t w = 0;
+        std::memcpy(&w, p + i, size - i);
+        h = mix_word(h, w);
+    }
+
+    return avalanche(h);
+}
+
+std::uint64_t hash_string(const std::string& s, std::uint64_t seed)
+{
+    return hash_bytes(s.data(), s.size(), seed);
+}
+
+std::uint64_t hash_mat(const cv::Mat& m, std::uint64_t seed)
+{
+    const std::int32_t header[3] = { m.type(), m.rows, m.cols };
+    std::uint64_t h = hash_bytes(header, sizeof(header), seed);
+
+    // Row by row, so continuous and non-continuous views of the same
+    // pixels hash alike.
+    const std::size_t rowBytes = static_cast<std::size_t>(m.cols) * m.elemSize();
+    for (int y = 0; y < m.rows; ++y)
+        h = hash_bytes(m.ptr(y), rowBytes, h);
+    return h;
+}
+
+std::string hash_to_hex(std::uint64_t h)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string s(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        s[static_cast<std::size_t>(i)] = digits[h & 0xF];
+        h >>= 4;
+    }
+    return s;
+}
+
+} // namespace utils
+} // namespace iqa
@@ -0,0 +1,356 @@
+#include "iqalab/utils/dataset_scan.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <opencv2/core/utility.hpp>
+
+#include "iqalab/utils/content_hash.hpp"
+#include "iqalab/utils/mapped_file.hpp"
+
+namespace fs = std::filesystem;
+
+namespace iqa::utils {
+
+namespace {
+
+constexpr char kManifestMagic[4] = { 'I', 'Q', 'D', 'M' };
+constexpr std::uint32_t kManifestVersion = 1;
+constexpr std::uint32_t kFlagProbed = 1u;
+
+std::int64_t mtime_of(const fs::path& p, std::error_code& ec)
+{
+    const auto t = fs::last_write_time(p, ec);
+    return ec ? 0 : static_cast<std::int64_t>(t.time_since_epoch().count());
+}
+
+// Result of scanning one directory (non-recursively).
+struct DirScan {
+    DatasetDirectory dir;
+    std::vector<fs::path> subdirs;   // relative to root
+    std::vector<DatasetEntry> entries;
+};
+
+DirScan scan_one_directory(const fs::path& root, const fs::path& rel,
+                           const DatasetScanOptions& options)
+{
+    DirScan out;
+    out.dir.relPath = rel;
+
+    const fs::path full = rel.empty() ? root : root / rel;
+    std::error_code ec;
+    out.dir.mtime = mtime_of(full, ec);
+
+    fs::directory_iterator it(full, fs::directory_options::skip_permission_denied, ec);
+    if (ec)
+        return out;
+
+    for (const fs::directory_entry& entry : it) {
+        std::error_code eec;
+        const fs::file_status st = entry.symlink_status(eec);
+        if (eec)
+            continue;
+
+        const fs::path childRel = rel / entry.path().filename();
+
+        if (fs::is_directory(st)) {
+            out.subdirs.push_back(childRel);
+            continue;
+        }
+        if (!entry.is_regular_file(eec) || !is_image_file(entry.path().string()))
+            continue;
+
+        DatasetEntry e;
+        e.relPath = childRel;
+        e.size  = static_cast<std::uint64_t>(entry.file_size(eec));
+        e.mtime = mtime_of(entry.path(), eec);
+        e.type  = get_image_type(entry.path().string());
+        if (options.probeHeaders) {
+            const ImageInfo info = probe_image(entry.path());
+            if (info.type != ImageType::Unknown)
+                e.type = info.type;
+            e.width  = info.width;
+            e.height = info.height;
+        }
+        out.entries.push_back(std::move(e));
+    }
+    return out;
+}
+
+// Little-endian binary writer/reader for the manifest.
+void put_bytes(std::string& buf, const void* p, std::size_t n)
+{
+    buf.append(static_cast<const char*>(p), n);
+}
+
+template <class T>
+void put(std::string& buf, T v)
+{
+    put_bytes(buf, &v, sizeof(v));
+}
+
+void put_string(std::string& buf, const std::string& s)
+{
+    put<std::uint32_t>(buf, static_cast<std::uint32_t>(s.size()));
+    put_bytes(buf, s.data(), s.size());
+}
+
+struct Reader {
+    const unsigned char* p;
+    const unsigned char* end;
+
+    template <class T>
+    bool get(T& v)
+    {
+        if (static_cast<std::size_t>(end - p) < sizeof(T))
+            return false;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    bool get_string(std::string& s)
+    {
+        std::uint32_t n = 0;
+        if (!get(n) || static_cast<std::size_t>(end - p) < n)
+            return false;
+        s.assign(reinterpret_cast<const char*>(p), n);
+        p += n;
+        return true;
+    }
+};
+
+fs::path normalized_root(const fs::path& root)
+{
+    std::error_code ec;
+    fs::path abs = fs::absolute(root, ec);
+    return (ec ? root : abs).lexically_normal();
+}
+
+} // anonymous namespace
+
+std::vector<fs::path> DatasetManifest::paths() const
+{
+    std::vector<fs::path> out;
+    out.reserve(entries.size());
+    for (const DatasetEntry& e : entries)
+        out.push_back(full_path(e));
+    return out;
+}
+
+DatasetManifest scan_dataset(const fs::path& root, const DatasetScanOptions& options)
+{
+    DatasetManifest m;
+    m.root = normalized_root(root);
+    m.headersProbed = options.probeHeaders;
+
+    std::error_code ec;
+    if (!fs::is_directory(m.root, ec))
+        return m;
+
+    // Breadth-first, one parallel task per directory of the current level.
+    std::vector<fs::path> level{ fs::path() };
+    while (!level.empty()) {
+        std::vector<DirScan> scans(level.size());
+        cv::parallel_for_(cv::Range(0, static_cast<int>(level.size())), [&](const cv::Range& r)
+        {
+            for (int i = r.start; i < r.end; ++i)
+                scans[static_cast<std::size_t>(i)] =
+                    scan_one_directory(m.root, level[static_cast<std::size_t>(i)], options);
+        });
+
+        std::vector<fs::path> next;
+        for (DirScan& s : scans) {
+            m.directories.push_back(std::move(s.dir));
+            for (DatasetEntry& e : s.entries)
+                m.entries.push_back(std::move(e));
+            for (fs::path& d : s.subdirs)
+                next.push_back(std::move(d));
+        }
+        level.swap(next);
+    }
+
+    std::sort(m.directories.begin(), m.directories.end(),
+              [](const DatasetDirectory& a, const DatasetDirectory& b) { return a.relPath < b.relPath; });
+    std::sort(m.entries.begin(), m.entries.end(),
+              [](const DatasetEntry& a, const DatasetEntry& b) { return a.relPath < b.relPath; });
+    return m;
+}
+
+void write_manifest(const DatasetManifest& manifest, const fs::path& file)
+{
+    std::string buf;
+    put_bytes(buf, kManifestMagic, sizeof(kManifestMagic));
+    put<std::uint32_t>(buf, kManifestVersion);
+
+    put<std::uint32_t>(buf, manifest.headersProbed ? kFlagProbed : 0u);
+    put_string(buf, manifest.root.generic_string());
+
+    put<std::uint64_t>(buf, manifest.directories.size());
+    for (const DatasetDirectory& d : manifest.directories) {
+        put_string(buf, d.relPath.generic_string());
+        put<std::int64_t>(buf, d.mtime);
+    }
+
+    put<std::uint64_t>(buf, manifest.entries.size());
+    for (const DatasetEntry& e : manifest.entries) {
+        put_string(buf, e.relPath.generic_string());
+        put<std::uint64_t>(buf, e.size);
+        put<std::int64_t>(buf, e.mtime);
+        put<std::uint8_t>(buf, static_cast<std::uint8_t>(e.type));
+        put<std::int32_t>(buf, e.width);
+        put<std::int32_t>(buf, e.height);
+    }
+
+    // Unique temporary name per writer, renamed into place when complete,
+    // so concurrent runs sharing a manifest never rename a partial file.
+    const std::size_t salt =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+        static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    fs::path tmp = file;
+    tmp += ".tmp" + hash_to_hex(salt);
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os)
+            throw std::runtime_error("write_manifest: cannot open " + tmp.string());
+        os.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        if (!os) {
+            os.close();
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            throw std::runtime_error("write_manifest: cannot write " + tmp.string());
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        throw std::runtime_error("write_manifest: cannot rename to " + file.string());
+    }
+}
+
+bool read_manifest(const fs::path& file, DatasetManifest& manifest)
+{
+    std::error_code ec;
+    if (!fs::is_regular_file(file, ec))
+        return false;
+
+    MappedFile mf;
+    try {
+        mf = MappedFile(file);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    Reader r{ mf.data(), mf.data() + mf.size() };
+    char magic[4];
+    std::uint32_t version = 0, flags = 0;
+    if (mf.size() < sizeof(magic))
+        return false;
+    std::memcpy(magic, r.p, sizeof(magic));
+    r.p += sizeof(magic);
+    if (std::memcmp(magic, kManifestMagic, sizeof(magic)) != 0 ||
+        !r.get(version) || version != kManifestVersion || !r.get(flags))
+        return false;
+
+    DatasetManifest m;
+    m.headersProbed = (flags & kFlagProbed) != 0;
+    std::string s;
+    if (!r.get_string(s))
+        return false;
+    m.root = fs::path(s);
+
+    std::uint64_t n = 0;
+    if (!r.get(n))
+        return false;
+    if (n > mf.size())
+        return false;
+    m.directories.resize(static_cast<std::size_t>(n));
+    for (DatasetDirectory& d : m.directories) {
+        if (!r.get_string(s) || !r.get(d.mtime))
+            return false;
+        d.relPath = fs::path(s);
+    }
+
+    if (!r.get(n) || n > mf.size())
+        return false;
+    m.entries.resize(static_cast<std::size_t>(n));
+    for (DatasetEntry& e : m.entries) {
+        std::uint8_t type = 0;
+        if (!r.get_string(s) || !r.get(e.size) || !r.get(e.mtime) ||
+            !r.get(type) || !r.get(e.width) || !r.get(e.height))
+            return false;
+        e.relPath = fs::path(s);
+        e.type = static_cast<ImageType>(type);
+    }
+
+    manifest = std::move(m);
+    return true;
+}
+
+bool manifest_is_current(const DatasetManifest& manifest, const DatasetScanOptions& options)
+{
+    std::atomic<bool> current{ true };
+
+    cv::parallel_for_(cv::Range(0, static_cast<int>(manifest.directories.size())),
+                      [&](const cv::Range& r)
+    {
+        for (int i = r.start; i < r.end && current.load(std::memory_order_relaxed); ++i) {
+            const DatasetDirectory& d = manifest.directories[static_cast<std::size_t>(i)];
+            std::error_code ec;
+            const std::int64_t t = mtime_of(d.relPath.empty() ? manifest.root : manifest.root / d.relPath, ec);
+            if (ec || t != d.mtime)
+                current = false;
+        }
+    });
+
+    if (!current || !options.validateFiles)
+        return current;
+
+    cv::parallel_for_(cv::Range(0, static_cast<int>(manifest.entries.size())),
+                      [&](const cv::Range& r)
+    {
+        for (int i = r.start; i < r.end && current.load(std::memory_order_relaxed); ++i) {
+            const DatasetEntry& e = manifest.entries[static_cast<std::size_t>(i)];
+            const fs::path p = manifest.full_path(e);
+            std::error_code ec;
+            const std::int64_t t = mtime_of(p, ec);
+            const std::uintmax_t size = ec ? 0 : fs::file_size(p, ec);
+            if (ec || t != e.mtime || size != e.size)
+                current = false;
+        }
+    });
+
+    return current;
+}
+
+DatasetManifest load_or_scan_dataset(const fs::path& root,
+                                     const fs::path& manifestFile,
+                                     const DatasetScanOptions& options)
+{
+    DatasetManifest m;
+    if (read_manifest(manifestFile, m) &&
+        m.root == normalized_root(root) &&
+        (m.headersProbed || !options.probeHeaders) &&
+        manifest_is_current(m, options))
+    {
+        return m;
+    }
+
+    m = scan_dataset(root, options);
+    try {
+        write_manifest(m, manifestFile);
+    } catch (const std::runtime_error&) {
+        // The manifest is only a cache: keep the scan, do not persist it.
+    }
+    return m;
+}
+
+} // namespace iqa::utils
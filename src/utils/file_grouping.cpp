@@ -4,7 +4,9 @@
 #include "iqalab/utils/path_utils.hpp"
 
 #include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
@@ -18,11 +20,23 @@ static std::string to_lower_copy(const std::string& s)
     return out;
 }
 
-static bool icase_less(const std::filesystem::path& a,
-                       const std::filesystem::path& b)
+// Sort paths case-insensitively by filename. Lowercase keys are computed
+// once per path, not once per comparison.
+static void sort_icase(std::vector<fs::path>& paths)
 {
-    return to_lower_copy(a.filename().string()) <
-           to_lower_copy(b.filename().string());
+    std::vector<std::pair<std::string, std::size_t>> keyed;
+    keyed.reserve(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i)
+        keyed.emplace_back(to_lower_copy(paths[i].filename().string()), i);
+
+    std::stable_sort(keyed.begin(), keyed.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<fs::path> sorted;
+    sorted.reserve(paths.size());
+    for (const auto& k : keyed)
+        sorted.push_back(std::move(paths[k.second]));
+    paths.swap(sorted);
 }
 
 std::vector<fs::path>
@@ -40,7 +54,7 @@ collect_reference_files(const fs::path& refDir)
         }
     }
 
-    std::sort(refs.begin(), refs.end(), icase_less);
+    sort_icase(refs);
     return refs;
 }
 
@@ -59,7 +73,7 @@ collect_distorted_files(const fs::path& distDir)
         }
     }
 
-    std::sort(dists.begin(), dists.end(), icase_less);
+    sort_icase(dists);
     return dists;
 }
 
@@ -70,21 +84,34 @@ FileGroups group_distorted_by_reference(
 {
     FileGroups groups;
 
-    // Precompute lowercase stems for distorted files
+    // Precomputed keys of distorted files: lowercase stem for matching,
+    // lowercase filename for the in-group order.
     struct DistInfo {
         std::string stemLower;
-        fs::path path;
+        std::string nameLower;
+        std::size_t index;   // position in distFiles
     };
 
     std::vector<DistInfo> distInfos;
     distInfos.reserve(distFiles.size());
-    for (const auto& dist : distFiles) {
+    for (std::size_t i = 0; i < distFiles.size(); ++i) {
         DistInfo info;
-        info.stemLower = stem_lower(dist);
-        info.path      = dist;
+        info.stemLower = stem_lower(distFiles[i]);
+        info.nameLower = to_lower_copy(distFiles[i].filename().string());
+        info.index     = i;
         distInfos.push_back(std::move(info));
     }
 
+    // Sorted by stem, all stems starting with a given prefix form one
+    // contiguous range beginning at lower_bound(prefix).
+    std::sort(distInfos.begin(), distInfos.end(),
+              [](const DistInfo& a, const DistInfo& b) {
+                  return a.stemLower < b.stemLower ||
+                         (a.stemLower == b.stemLower && a.index < b.index);
+              });
+
+    std::vector<const DistInfo*> matches;
+
     for (const auto& ref : refFiles) {
         std::string refStemLower = stem_lower(ref);
         if (refStemLower.empty()) {
@@ -93,19 +120,70 @@ FileGroups group_distorted_by_reference(
 
         auto& vec = groups[refStemLower];  // creates vector if missing
 
-        for (const auto& dinfo : distInfos) {
-            // starts_with(refStemLower)
-            if (dinfo.stemLower.rfind(refStemLower, 0) == 0) {
-                vec.push_back(dinfo.path);
-            }
-        }
+        auto it = std::lower_bound(distInfos.begin(), distInfos.end(), refStemLower,
+                                   [](const DistInfo& d, const std::string& key) {
+                                       return d.stemLower < key;
+                                   });
 
-        // keep deterministic ordering
-        std::sort(vec.begin(), vec.end(), icase_less);
+        // starts_with(refStemLower)
+        matches.clear();
+        for (; it != distInfos.end() && it->stemLower.compare(0, refStemLower.size(), refStemLower) == 0; ++it)
+            matches.push_back(&*it);
+
+        if (matches.empty())
+            continue;
+
+        // keep deterministic ordering: case-insensitive filename, then
+        // input order (a reference repeated under the same key appends its
+        // matches again, as before)
+        std::sort(matches.begin(), matches.end(),
+                  [](const DistInfo* a, const DistInfo* b) {
+                      return a->nameLower < b->nameLower ||
+                             (a->nameLower == b->nameLower && a->index < b->index);
+                  });
+
+        if (vec.empty()) {
+            vec.reserve(matches.size());
+            for (const DistInfo* d : matches)
+                vec.push_back(distFiles[d->index]);
+        } else {
+            for (const DistInfo* d : matches)
+                vec.push_back(distFiles[d->index]);
+            sort_icase(vec);
+        }
     }
 
     return groups;
 }
 
+std::vector<ImagePair> pairs_from_groups(
+    const std::vector<fs::path>& refFiles,
+    const FileGroups& groups
+)
+{
+    std::vector<ImagePair> pairs;
+    for (const fs::path& ref : refFiles) {
+        const auto it = groups.find(stem_lower(ref));
+        if (it == groups.end())
+            continue;
+        for (const fs::path& dist : it->second)
+            pairs.push_back(ImagePair{ref, dist});
+    }
+    return pairs;
+}
+
+std::vector<ImagePair> load_pairs_from_file(const fs::path& listPath)
+{
+    std::ifstream in(listPath);
+    if (!in)
+        throw std::runtime_error("Cannot open pairs file: " + listPath.string());
+
+    std::vector<ImagePair> pairs;
+    std::string ref, dist;
+    while (in >> ref >> dist)
+        pairs.push_back(ImagePair{ref, dist});
+    return pairs;
+}
+
 } // namespace iqa::utils
 
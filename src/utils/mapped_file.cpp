@@ -0,0 +1,104 @@
+#include "iqalab/utils/mapped_file.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define IQALAB_HAVE_MMAP 1
+#endif
+
+namespace iqa {
+namespace utils {
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+#ifdef IQALAB_HAVE_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("MappedFile: cannot open " + path.string());
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("MappedFile: cannot stat " + path.string());
+    }
+
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size > 0) {
+        void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            m_size = 0;
+            throw std::runtime_error("MappedFile: cannot map " + path.string());
+        }
+        m_data = static_cast<const unsigned char*>(p);
+        m_mapped = true;
+    }
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        throw std::runtime_error("MappedFile: cannot open " + path.string());
+
+    m_size = static_cast<std::size_t>(in.tellg());
+    if (m_size > 0) {
+        unsigned char* buf = new unsigned char[m_size];
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(buf), static_cast<std::streamsize>(m_size))) {
+            delete[] buf;
+            m_size = 0;
+            throw std::runtime_error("MappedFile: cannot read " + path.string());
+        }
+        m_data = buf;
+    }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_mapped(std::exchange(other.m_mapped, false))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_data   = std::exchange(other.m_data, nullptr);
+        m_size   = std::exchange(other.m_size, 0);
+        m_mapped = std::exchange(other.m_mapped, false);
+    }
+    return *this;
+}
+
+void MappedFile::release()
+{
+    if (m_data != nullptr) {
+#ifdef IQALAB_HAVE_MMAP
+        if (m_mapped)
+            ::munmap(const_cast<unsigned char*>(m_data), m_size);
+        else
+            delete[] m_data;
+#else
+        delete[] m_data;
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+}
+
+} // namespace utils
+} // namespace iqa
@@ -0,0 +1,35 @@
+#include "iqalab/utils/mask_spans.hpp"
+
+namespace iqa {
+
+MaskSpans build_mask_spans(const cv::Mat& mask, uchar threshold)
+{
+    CV_Assert(mask.type() == CV_8U);
+    CV_Assert(threshold >= 1);
+
+    MaskSpans out;
+    out.size = mask.size();
+    out.rowStart.reserve(static_cast<std::size_t>(mask.rows) + 1);
+    out.rowStart.push_back(0);
+
+    for (int y = 0; y < mask.rows; ++y) {
+        const uchar* row = mask.ptr<uchar>(y);
+        int x = 0;
+        while (x < mask.cols) {
+            while (x < mask.cols && row[x] < threshold)
+                ++x;
+            if (x == mask.cols)
+                break;
+            const int x0 = x;
+            while (x < mask.cols && row[x] >= threshold)
+                ++x;
+            out.spans.push_back(MaskSpan{x0, x});
+            out.area += static_cast<std::size_t>(x - x0);
+        }
+        out.rowStart.push_back(static_cast<int>(out.spans.size()));
+    }
+
+    return out;
+}
+
+} // namespace iqa
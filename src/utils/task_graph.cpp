@@ -0,0 +1,156 @@
+#include "iqalab/utils/task_graph.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "iqalab/utils/thread_pool.hpp"
+
+namespace iqa {
+namespace utils {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_between(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+} // anonymous namespace
+
+TaskGraph::Id TaskGraph::add(std::string name, Fn fn, std::vector<Id> dependencies)
+{
+    const Id id = m_nodes.size();
+    for (Id dep : dependencies) {
+        if (dep >= id)
+            throw std::invalid_argument("TaskGraph: dependency added after its dependent: " + name);
+    }
+
+    for (Id dep : dependencies)
+        m_nodes[dep].dependents.push_back(id);
+
+    Node node;
+    node.name = std::move(name);
+    node.fn = std::move(fn);
+    node.dependencies = std::move(dependencies);
+    m_nodes.push_back(std::move(node));
+    return id;
+}
+
+void TaskGraph::run()
+{
+    m_timings.assign(m_nodes.size(), Timing());
+    const Clock::time_point t0 = Clock::now();
+
+    std::exception_ptr error;
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        Timing& t = m_timings[i];
+        t.name = m_nodes[i].name;
+        if (error)
+            continue;
+
+        const Clock::time_point start = Clock::now();
+        try {
+            m_nodes[i].fn();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        t.startMs = ms_between(t0, start);
+        t.durationMs = ms_between(start, Clock::now());
+        t.ran = true;
+    }
+
+    m_wallMs = ms_between(t0, Clock::now());
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void TaskGraph::run(ThreadPool& pool)
+{
+    const std::size_t n = m_nodes.size();
+    m_timings.assign(n, Timing());
+    for (std::size_t i = 0; i < n; ++i)
+        m_timings[i].name = m_nodes[i].name;
+    if (n == 0) {
+        m_wallMs = 0.0;
+        return;
+    }
+
+    // Shared by the pool tasks; lives until run() returns, which happens
+    // only after the last task has signalled completion.
+    struct State
+    {
+        std::unique_ptr<std::atomic<std::size_t>[]> pending;   // unfinished dependencies
+        std::atomic<bool> failed{false};
+        Clock::time_point t0;
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t remaining = 0;
+        std::exception_ptr error;
+    } state;
+
+    state.pending = std::make_unique<std::atomic<std::size_t>[]>(n);
+    for (std::size_t i = 0; i < n; ++i)
+        state.pending[i].store(m_nodes[i].dependencies.size(), std::memory_order_relaxed);
+    state.remaining = n;
+    state.t0 = Clock::now();
+
+    // Each task submits the dependents it releases, so the pool sees a task
+    // only once it is ready and no worker ever blocks inside the graph.
+    std::function<void(Id)> schedule = [&](Id id) {
+        pool.submit([&, id] {
+            Timing& t = m_timings[id];
+            if (!state.failed.load(std::memory_order_acquire)) {
+                const Clock::time_point start = Clock::now();
+                try {
+                    m_nodes[id].fn();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    if (!state.error)
+                        state.error = std::current_exception();
+                    state.failed.store(true, std::memory_order_release);
+                }
+                t.startMs = ms_between(state.t0, start);
+                t.durationMs = ms_between(start, Clock::now());
+                t.ran = true;
+            }
+
+            for (Id next : m_nodes[id].dependents) {
+                if (state.pending[next].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    schedule(next);
+            }
+
+            // Notify under the lock: once run() sees remaining == 0 it
+            // returns and `state` is gone.
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (--state.remaining == 0)
+                state.done.notify_all();
+        });
+    };
+
+    for (std::size_t i = 0; i < n; ++i) {
+        if (m_nodes[i].dependencies.empty())
+            schedule(i);
+    }
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.done.wait(lock, [&] { return state.remaining == 0; });
+    m_wallMs = ms_between(state.t0, Clock::now());
+
+    if (state.error) {
+        std::exception_ptr error = state.error;
+        lock.unlock();
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace utils
+} // namespace iqa
@@ -0,0 +1,139 @@
+#include "iqalab/utils/thread_pool.hpp"
+
+#include <utility>
+
+namespace iqa {
+namespace utils {
+
+namespace {
+
+// Pool and queue index of the calling worker thread, if any.
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local std::size_t t_worker = 0;
+
+} // anonymous namespace
+
+ThreadPool::ThreadPool(int threads, WorkerInit init)
+    : m_init(std::move(init))
+{
+    if (threads <= 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0)
+        threads = 1;
+
+    m_queues.reserve(static_cast<std::size_t>(threads));
+    for (int i = 0; i < threads; ++i)
+        m_queues.push_back(std::make_unique<Queue>());
+
+    m_threads.reserve(static_cast<std::size_t>(threads));
+    for (int i = 0; i < threads; ++i)
+        m_threads.emplace_back(&ThreadPool::worker_loop, this, static_cast<std::size_t>(i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& t : m_threads)
+        t.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+    const std::size_t target = t_pool == this
+        ? t_worker
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    {
+        // Push and count atomically with respect to the workers' wait, so
+        // the counters never run behind the queues.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        {
+            Queue& q = *m_queues[target];
+            std::lock_guard<std::mutex> qlock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        ++m_queued;
+        ++m_unfinished;
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [&] { return m_unfinished == 0; });
+
+    if (m_error) {
+        std::exception_ptr error = std::move(m_error);
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::worker_loop(std::size_t id)
+{
+    t_pool = this;
+    t_worker = id;
+    if (m_init)
+        m_init(static_cast<int>(id));
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_queued > 0; });
+            if (m_queued == 0)
+                return;   // stopping and drained
+            // Reserve one queued task; only reserved workers take tasks, so
+            // one is guaranteed to be in some queue.
+            --m_queued;
+        }
+
+        Task task;
+        while (!take_task(id, task))
+            std::this_thread::yield();
+        run_task(task);
+    }
+}
+
+bool ThreadPool::take_task(std::size_t id, Task& task)
+{
+    const std::size_t n = m_queues.size();
+    for (std::size_t k = 0; k < n; ++k) {
+        Queue& q = *m_queues[(id + k) % n];   // own queue first, then steal
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run_task(Task& task)
+{
+    std::exception_ptr error;
+    try {
+        task();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    task = nullptr;
+
+    bool idle = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (error && !m_error)
+            m_error = error;
+        idle = --m_unfinished == 0;
+    }
+    if (idle)
+        m_idle.notify_all();
+}
+
+} // namespace utils
+} // namespace iqa
@@ -0,0 +1,395 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "iqalab/batch_evaluator.hpp"
+#include "iqalab/blur.hpp"
+#include "iqalab/image_cache.hpp"
+#include "iqalab/lab_disk_cache.hpp"
+#include "iqalab/mapped_image.hpp"
+#include "iqalab/mse.hpp"
+#include "iqalab/pair_metrics.hpp"
+#include "iqalab/region_masks.hpp"
+#include "iqalab/region_provider.hpp"
+#include "iqalab/utils/file_grouping.hpp"
+#include "iqalab/utils/thread_pool.hpp"
+
+// Self-contained consistency checks of the pair metric pipeline on
+// synthetic images written to a temporary directory:
+//  - the mapped BMP / PNM readers match cv::imread (bottom-up and
+//    top-down BMP, RGB PPM, PNM with maxval below 255);
+//  - BatchEvaluator writes the same CSV with 1 and with N threads;
+//  - compute_pair_metrics on a pool equals the sequential overload, and
+//    both match the per-mask relative_blur_* / lab_channel_mse values;
+//  - a MetricSelection subset yields the same values as the full set;
+//  - Lab32DiskCache round-trips an entry in Float32 and Float16, and
+//    ImageCache counts its hits, decodes and failures apart.
+// Exits with 0 on success, 1 on the first failed check.
+
+namespace fs = std::filesystem;
+
+static int g_failures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+    if (!ok) {
+        std::cerr << "FAILED: " << what << "\n";
+        ++g_failures;
+    }
+}
+
+static void check_close(double a, double b, const std::string& what)
+{
+    const double tol = 1e-9 * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+    if (std::abs(a - b) > tol) {
+        std::cerr << "FAILED: " << what << ": " << a << " vs " << b << "\n";
+        ++g_failures;
+    }
+}
+
+// Reference with flat areas, gradients, edges and texture.
+static cv::Mat make_reference(int seed, int width, int height)
+{
+    cv::Mat img(height, width, CV_8UC3);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            img.at<cv::Vec3b>(y, x) = cv::Vec3b(
+                static_cast<uchar>((x * 255) / width),
+                static_cast<uchar>((y * 255) / height),
+                static_cast<uchar>(96 + 32 * seed));
+
+    cv::rectangle(img, cv::Rect(width / 8, height / 6, width / 3, height / 3),
+                  cv::Scalar(20, 200, 60), cv::FILLED);
+    cv::circle(img, cv::Point(2 * width / 3, height / 2), height / 4,
+               cv::Scalar(230, 40 + 50 * seed, 90), cv::FILLED);
+    for (int i = 0; i < 12; ++i)
+        cv::line(img, cv::Point(0, i * height / 12), cv::Point(width - 1, (i * height / 12 + 40) % height),
+                 cv::Scalar(10 * i, 255 - 10 * i, 128), 1);
+
+    cv::Mat noise(img.size(), CV_8UC3);
+    cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(12));
+    img += noise;
+    return img;
+}
+
+static std::vector<iqa::utils::ImagePair> write_dataset(const fs::path& dir)
+{
+    std::vector<iqa::utils::ImagePair> pairs;
+    cv::setRNGSeed(1234);
+
+    const char* refExt[] = { ".png", ".bmp", ".ppm" };
+    for (int r = 0; r < 3; ++r) {
+        const cv::Mat ref = make_reference(r, 160 + 16 * r, 120);
+        const fs::path refPath = dir / ("ref" + std::to_string(r) + refExt[r]);
+        cv::imwrite(refPath.string(), ref);
+
+        std::vector<std::pair<std::string, cv::Mat>> dists;
+        cv::Mat blurred, noisy, sharpened;
+        cv::GaussianBlur(ref, blurred, cv::Size(5, 5), 1.5);
+        dists.emplace_back("blur.png", blurred);
+
+        cv::Mat noise(ref.size(), CV_8UC3);
+        cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(8));
+        cv::add(ref, noise, noisy);
+        dists.emplace_back("noise.bmp", noisy);
+
+        cv::addWeighted(ref, 1.8, blurred, -0.8, 0.0, sharpened);
+        dists.emplace_back("sharp.ppm", sharpened);
+
+        dists.emplace_back("jpeg.jpg", ref);
+
+        for (const auto& [name, img] : dists) {
+            const fs::path distPath = dir / ("ref" + std::to_string(r) + "_" + name);
+            if (distPath.extension() == ".jpg")
+                cv::imwrite(distPath.string(), img, { cv::IMWRITE_JPEG_QUALITY, 30 });
+            else
+                cv::imwrite(distPath.string(), img);
+            pairs.push_back({ refPath, distPath });
+        }
+    }
+    return pairs;
+}
+
+static void put_le(std::ofstream& os, std::uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        os.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+// 24-bit BI_RGB BMP stored top-down (negative height); cv::imwrite only
+// writes bottom-up ones.
+static void write_top_down_bmp(const fs::path& path, const cv::Mat& bgr)
+{
+    const std::uint32_t step = ((static_cast<std::uint32_t>(bgr.cols) * 24 + 31) / 32) * 4;
+    const std::uint32_t imageSize = step * static_cast<std::uint32_t>(bgr.rows);
+
+    std::ofstream os(path, std::ios::binary);
+    os.write("BM", 2);
+    put_le(os, 54 + imageSize, 4);
+    put_le(os, 0, 4);
+    put_le(os, 54, 4);
+    put_le(os, 40, 4);
+    put_le(os, static_cast<std::uint32_t>(bgr.cols), 4);
+    put_le(os, static_cast<std::uint32_t>(-bgr.rows), 4);
+    put_le(os, 1, 2);
+    put_le(os, 24, 2);
+    put_le(os, 0, 4);
+    put_le(os, imageSize, 4);
+    put_le(os, 2835, 4);
+    put_le(os, 2835, 4);
+    put_le(os, 0, 4);
+    put_le(os, 0, 4);
+
+    const std::string padding(step - static_cast<std::uint32_t>(bgr.cols) * 3, '\0');
+    for (int y = 0; y < bgr.rows; ++y) {
+        os.write(reinterpret_cast<const char*>(bgr.ptr(y)), bgr.cols * 3);
+        os.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    }
+}
+
+// Binary PGM (1 channel) or PPM (3 channels, RGB on disk) with the given
+// maxval; samples of `img` must not exceed it.
+static void write_pnm(const fs::path& path, const cv::Mat& img, int maxval)
+{
+    std::ofstream os(path, std::ios::binary);
+    os << (img.channels() == 1 ? "P5" : "P6") << "\n# iqalab test\n"
+       << img.cols << " " << img.rows << "\n" << maxval << "\n";
+    cv::Mat rgb = img;
+    if (img.channels() == 3)
+        cv::cvtColor(img, rgb, cv::COLOR_BGR2RGB);
+    for (int y = 0; y < rgb.rows; ++y)
+        os.write(reinterpret_cast<const char*>(rgb.ptr(y)), rgb.cols * rgb.channels());
+}
+
+// The mapped readers give what cv::imread gives, for BGR and for Lab.
+static void check_raw_reader(const fs::path& path)
+{
+    const std::string name = path.filename().string();
+    const cv::Mat expected = cv::imread(path.string(), cv::IMREAD_COLOR);
+    check(!expected.empty(), name + ": cv::imread reads the fixture");
+    if (expected.empty())
+        return;
+
+    const cv::Mat bgr = iqa::read_image_bgr(path);
+    check(bgr.type() == expected.type() && bgr.size() == expected.size() &&
+          cv::norm(bgr, expected, cv::NORM_INF) == 0.0,
+          name + ": read_image_bgr == cv::imread");
+
+    const cv::Mat lab = iqa::read_image_lab32(path);
+    check(lab.size() == expected.size() &&
+          cv::norm(lab, iqa::lab32_from_bgr8(expected), cv::NORM_INF) == 0.0,
+          name + ": read_image_lab32 == lab32_from_bgr8(cv::imread)");
+}
+
+static void check_raw_readers(const fs::path& dir, const std::vector<iqa::utils::ImagePair>& pairs)
+{
+    // Bottom-up BMP and PPM written by cv::imwrite.
+    for (const iqa::utils::ImagePair& pair : pairs) {
+        for (const fs::path& path : { pair.refPath, pair.distPath }) {
+            if (path.extension() == ".bmp" || path.extension() == ".ppm")
+                check_raw_reader(path);
+        }
+    }
+
+    // Odd width: rows are padded to 4 bytes.
+    const cv::Mat img = make_reference(3, 37, 23);
+    const fs::path topDown = dir / "top_down.bmp";
+    write_top_down_bmp(topDown, img);
+    iqa::MappedImage raw;
+    check(iqa::map_raw_image(topDown, raw) && raw.zeroCopy, "top-down BMP is mapped in place");
+    check_raw_reader(topDown);
+
+    cv::Mat low, gray;
+    img.convertTo(low, CV_8U, 100.0 / 255.0);
+    cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+    const fs::path ppm100 = dir / "maxval100.ppm";
+    const fs::path pgm255 = dir / "maxval255.pgm";
+    write_pnm(ppm100, low, 100);
+    write_pnm(pgm255, gray, 255);
+    check(!iqa::map_raw_image(ppm100, raw), "PNM with maxval below 255 is left to cv::imread");
+    check(iqa::map_raw_image(pgm255, raw) && raw.order == iqa::PixelOrder::Gray, "PGM is mapped");
+    check_raw_reader(ppm100);
+    check_raw_reader(pgm255);
+}
+
+static std::string run_batch(const std::vector<iqa::utils::ImagePair>& pairs, int threads,
+                             const iqa::MetricSelection& metrics)
+{
+    iqa::BatchOptions options;
+    options.execution.threads = threads;
+    options.metrics = metrics;
+
+    std::ostringstream csv, log;
+    iqa::BatchEvaluator evaluator(options);
+    const iqa::BatchSummary summary = evaluator.run(pairs, csv, &log);
+    check(summary.scored == pairs.size() && summary.failed == 0,
+          "batch with " + std::to_string(threads) + " threads scored every pair: " + log.str());
+    return csv.str();
+}
+
+static std::string csv_row(const iqa::PairMetrics& m,
+                           const iqa::MetricSelection& selection = iqa::MetricSelection())
+{
+    std::ostringstream os;
+    os.precision(17);
+    iqa::write_pair_metrics_csv_row(os, "r", "d", m, selection);
+    return os.str();
+}
+
+static cv::Mat dilate_ellipse(const cv::Mat& mask, int r)
+{
+    const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2 * r + 1, 2 * r + 1));
+    cv::Mat out;
+    cv::dilate(mask, out, kernel);
+    return out;
+}
+
+static void check_pair_metrics(const iqa::utils::ImagePair& pair)
+{
+    const std::string name = pair.distPath.filename().string();
+    const cv::Mat labRef  = iqa::read_image_lab32(pair.refPath);
+    const cv::Mat labDist = iqa::read_image_lab32(pair.distPath);
+    check(!labRef.empty() && !labDist.empty(), name + ": images readable");
+    if (labRef.empty() || labDist.empty())
+        return;
+
+    // Lab straight from the mapping equals the BGR route.
+    const cv::Mat viaBgr = iqa::lab32_from_bgr8(iqa::read_image_bgr(pair.distPath));
+    check(cv::norm(viaBgr, labDist, cv::NORM_INF) == 0.0, name + ": read_image_lab32 == lab32_from_bgr8");
+
+    const auto regions = iqa::make_default_region_provider();
+    const iqa::PairMetrics seq = iqa::compute_pair_metrics(labRef, labDist, *regions);
+
+    iqa::utils::ThreadPool pool(4);
+    iqa::PairMetricsTimings timings;
+    const iqa::PairMetrics par = iqa::compute_pair_metrics(labRef, labDist, *regions, pool, &timings);
+    check(csv_row(seq) == csv_row(par), name + ": pool == sequential");
+    check(timings.tasks.size() == 14, name + ": full graph has 14 tasks");
+
+    // Baseline: per-mask evaluation as before the task graph.
+    const iqa::RegionMasks masks = regions->compute_regions(labRef);
+    const cv::Mat blurMask[] = { dilate_ellipse(masks.flat(), 1),
+                                 dilate_ellipse(masks.mid(), 2),
+                                 dilate_ellipse(masks.detail(), 3) };
+    const double nBlur[]   = { seq.n_blur_flat, seq.n_blur_mid, seq.n_blur_detail };
+    const double blurL[]   = { seq.blur_L_flat, seq.blur_L_mid, seq.blur_L_detail };
+    const double blurAb[]  = { seq.blur_ab_flat, seq.blur_ab_mid, seq.blur_ab_detail };
+    const double sharpL[]  = { seq.sharp_L_flat, seq.sharp_L_mid, seq.sharp_L_detail };
+    const double sharpAb[] = { seq.sharp_ab_flat, seq.sharp_ab_mid, seq.sharp_ab_detail };
+    const double mseL[]    = { seq.mse_L_flat, seq.mse_L_mid, seq.mse_L_detail };
+    const double mseAb[]   = { seq.mse_ab_flat, seq.mse_ab_mid, seq.mse_ab_detail };
+    const cv::Mat regionMask[] = { masks.flat(), masks.mid(), masks.detail() };
+
+    for (int k = 0; k < 3; ++k) {
+        const std::string cls = name + " class " + std::to_string(k);
+        check(nBlur[k] == cv::countNonZero(blurMask[k]), cls + ": n_blur");
+        check_close(blurL[k],   iqa::blur::relative_blur_L(labRef, labDist, blurMask[k]),   cls + ": blur_L");
+        check_close(blurAb[k],  iqa::blur::relative_blur_ab(labRef, labDist, blurMask[k]),  cls + ": blur_ab");
+        check_close(sharpL[k],  iqa::blur::relative_sharp_L(labRef, labDist, blurMask[k]),  cls + ": sharp_L");
+        check_close(sharpAb[k], iqa::blur::relative_sharp_ab(labRef, labDist, blurMask[k]), cls + ": sharp_ab");
+        if (cv::countNonZero(regionMask[k]) == 0)
+            continue;
+        check_close(mseL[k], iqa::mse::lab_channel_mse(labRef, labDist, 0, regionMask[k]), cls + ": mse_L");
+        check_close(mseAb[k],
+                    iqa::mse::lab_channel_mse(labRef, labDist, 1, regionMask[k]) +
+                    iqa::mse::lab_channel_mse(labRef, labDist, 2, regionMask[k]),
+                    cls + ": mse_ab");
+    }
+    check_close(seq.mse_L_all, iqa::mse::lab_channel_mse(labRef, labDist, 0), name + ": mse_L_all");
+
+    // A subset computes the same values for its columns, and only its tasks.
+    const iqa::MetricSelection subset = iqa::MetricSelection::parse("mse_L_all,blur_L_detail,sharp_ab_mid");
+    const iqa::PairMetrics part = iqa::compute_pair_metrics(labRef, labDist, *regions, pool, &timings, subset);
+    check(csv_row(part, subset) == csv_row(seq, subset), name + ": subset == full");
+    check(part.halo.halo_L_strength_detail == 0.0 && part.mse_ab_all == 0.0, name + ": subset skips others");
+    check(timings.tasks.size() == 10, name + ": subset graph has 10 tasks");
+}
+
+static void check_lab_disk_cache(const fs::path& dir, const fs::path& source,
+                                 iqa::Lab32DiskCache::Storage storage, const std::string& what)
+{
+    const cv::Mat expected = iqa::read_image_lab32(source);
+    {
+        iqa::Lab32DiskCache cache(dir, storage);
+        cv::Mat lab;
+        check(!cache.lookup(source, lab), what + ": empty cache misses");
+        cache.store(source, expected);
+        check(cache.lookup(source, lab) && cv::norm(lab, expected, cv::NORM_INF) == 0.0,
+              what + ": lookup after store");
+    }
+
+    // A new instance (next run) is served from the file.
+    iqa::Lab32DiskCache cache(dir, storage);
+    const cv::Mat lab = cache.load_lab32(source);
+    check(lab.type() == CV_32FC3 && lab.size() == expected.size() &&
+          cv::norm(lab, expected, cv::NORM_INF) == 0.0,
+          what + ": load_lab32 after restart is exact");
+    check(cache.stats().hits == 1 && cache.stats().misses == 0, what + ": served from the file");
+}
+
+// Memory hits, decodes, Lab cache hits and unreadable files are counted
+// apart; `diskDir` already holds the Lab of `source`.
+static void check_image_cache_stats(const fs::path& diskDir, const fs::path& source)
+{
+    iqa::Lab32DiskCache diskCache(diskDir, iqa::Lab32DiskCache::Storage::Float32);
+    iqa::ImageCache cache;
+    cache.set_disk_cache(&diskCache);
+
+    check(!cache.load_lab32(source).empty(), "image cache: Lab from the disk cache");
+    check(!cache.load_lab32(source).empty(), "image cache: Lab from memory");
+    check(!cache.load_bgr(source).empty(), "image cache: BGR decoded");
+    check(cache.load_lab32(diskDir / "missing.png").empty(), "image cache: missing file");
+
+    const iqa::ImageCache::Stats st = cache.stats();
+    check(st.diskHits == 1 && st.hits == 1 && st.misses == 1 && st.failed == 1,
+          "image cache stats: 1 disk hit, 1 hit, 1 decoded, 1 failed");
+}
+
+int main()
+{
+    const fs::path dir = fs::temp_directory_path() /
+        ("iqalab_pair_metrics_" + std::to_string(cv::getTickCount()));
+    fs::create_directories(dir);
+
+    const std::vector<iqa::utils::ImagePair> pairs = write_dataset(dir);
+    check_raw_readers(dir, pairs);
+
+    const iqa::MetricSelection all;
+    const std::string csv1 = run_batch(pairs, 1, all);
+    const std::string csvN = run_batch(pairs, 6, all);
+    check(csv1 == csvN, "BatchEvaluator CSV identical for 1 and 6 threads");
+    check(std::count(csv1.begin(), csv1.end(), '\n') == static_cast<long>(pairs.size()) + 1,
+          "one CSV row per pair");
+
+    const iqa::MetricSelection subset = iqa::MetricSelection::parse("n_region_detail,mse_ab_all,halo_ab_width_detail");
+    check(run_batch(pairs, 1, subset) == run_batch(pairs, 6, subset),
+          "BatchEvaluator subset CSV identical for 1 and 6 threads");
+
+    for (const iqa::utils::ImagePair& pair : pairs)
+        check_pair_metrics(pair);
+
+    check(iqa::pair_metrics_graph_width(iqa::MetricSelection::parse("mse_L_all")) == 1,
+          "graph width of a single-task selection");
+
+    check_lab_disk_cache(dir / "lab32", pairs[0].refPath, iqa::Lab32DiskCache::Storage::Float32, "Float32 cache");
+    check_lab_disk_cache(dir / "lab16", pairs[1].distPath, iqa::Lab32DiskCache::Storage::Float16, "Float16 cache");
+    check_image_cache_stats(dir / "lab32", pairs[0].refPath);
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+
+    if (g_failures != 0) {
+        std::cerr << g_failures << " check(s) failed\n";
+        return 1;
+    }
+    std::cout << "pair_metrics_consistency: all checks passed\n";
+    return 0;
+}